@@ -23,12 +23,34 @@
  * SUCH DAMAGE.
  */
 
+#include "virtual_oss_ctl_backend.h"
+#include "virtual_oss_ctl_io.h"
 #include "virtual_oss_ctl_mainwindow.h"
+#include "virtual_oss_ctl_profile.h"
+#include "virtual_oss_ctl_stall.h"
+#include "virtual_oss_ctl_trace.h"
+
+#ifdef VOSS_DEBUG_ALLOC
+uint64_t voss_repaint_bytes;
+int voss_repaint_depth;
+#endif
 
 static void
 usage(void)
 {
-	fprintf(stderr, "usage: virtual_oss_ctl -f /dev/vdsp.ctl\n");
+	fprintf(stderr, "usage: virtual_oss_ctl -f /dev/vdsp.ctl [-m] [-M] [-p] [-s <ms>] [-t <file>] [-w <ms>]\n"
+	    "\t-f Control device, or \"sim:key=value,...\" for the built-in simulator\n"
+	    "\t   with the keys dev, loop, chans, imon, omon, lmon, master, fir,\n"
+	    "\t   rate, bits and latency (us per request), or \"replay:<file>\" and\n"
+	    "\t   \"replay-fast:<file>\" to replay a trace with or without its ioctl durations\n"
+	    "\t-m Show meter bridge with all channels\n"
+	    "\t-M Same as -m, but render the meter bridge in a separate thread\n"
+	    "\t-p Profile the watchdog tick and the control device ioctls,\n"
+	    "\t   show the tick profile and dump both to stderr on exit\n"
+	    "\t-s Report GUI stalls longer than this many milliseconds, 0 disables, default %d\n"
+	    "\t-t Record all control device requests into a trace file\n"
+	    "\t-w Delay control changes by up to this many milliseconds, default %d\n",
+	    VOSS_STALL_THRESHOLD, VOSS_WRITE_DELAY);
 	exit(EX_USAGE);
 }
 
@@ -36,8 +58,15 @@ int
 main(int argc, char **argv)
 {
 	QApplication app(argc, argv);
-	const char *optstring = "f:h?";
+	const char *optstring = "f:mMps:t:w:h?";
 	const char *ctldevice = NULL;
+	const char *tracefile = NULL;
+	int meterbridge = 0;
+	int write_delay = VOSS_WRITE_DELAY;
+	VOSSBackend *backend;
+	int profile = 0;
+	int stall = VOSS_STALL_THRESHOLD;
+	int ret;
 	int c;
 
 	while ((c = getopt(argc, argv, optstring)) != -1) {
@@ -45,6 +74,28 @@ main(int argc, char **argv)
 		case 'f':
 			ctldevice = optarg;
 			break;
+		case 'm':
+			meterbridge = 1;
+			break;
+		case 'M':
+			meterbridge = 2;
+			break;
+		case 'p':
+			profile = 1;
+			break;
+		case 's':
+			stall = atoi(optarg);
+			if (stall < 0)
+				usage();
+			break;
+		case 't':
+			tracefile = optarg;
+			break;
+		case 'w':
+			write_delay = atoi(optarg);
+			if (write_delay < 0)
+				usage();
+			break;
 		default:
 			usage();
 			break;
@@ -54,9 +105,47 @@ main(int argc, char **argv)
 	if (ctldevice == NULL)
 		usage();
 
-	VOSSMainWindow *mw = new VOSSMainWindow(ctldevice);
+	backend = VOSSBackend::create(ctldevice);
+	if (backend == NULL)
+		errx(EX_USAGE, "Invalid simulator specification or trace: %s", ctldevice);
+	if (tracefile != NULL) {
+		backend = VOSSTraceRecorder::create(backend, tracefile);
+		if (backend == NULL)
+			err(EX_CANTCREAT, "Cannot create trace file %s", tracefile);
+	}
+	voss_io.setBackend(backend);
+	voss_io.setProfile(profile);
+
+	if (stall > 0)
+		voss_stall = new VOSSStallDetector(stall);
+
+	VOSSMainWindow *mw = new VOSSMainWindow(ctldevice, meterbridge,
+	    write_delay, profile);
 
 	mw->show();
 
-	return (app.exec());
+	/* the startup time is not a stall */
+	if (voss_stall != 0) {
+		voss_stall->beat();
+		voss_stall->start();
+	}
+
+	ret = app.exec();
+
+	if (profile)
+		mw->handle_dump();
+
+	if (voss_stall != 0) {
+		VOSSStallDetector *detector = voss_stall;
+
+		voss_stall = 0;
+		delete detector;
+	}
+
+	/* write out the edits still waiting for the write delay */
+	delete mw;
+
+	backend->flush();
+
+	return (ret);
 }
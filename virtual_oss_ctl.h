@@ -28,12 +28,21 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <sysexits.h>
 
+#include <sys/ioccom.h>
+#include <sys/resource.h>
+
 #include <errno.h>
 #include <err.h>
+#include <time.h>
+
+#ifdef VOSS_DEBUG_ALLOC
+#include <malloc_np.h>
+#endif
 
 #include <QApplication>
 #include <QDialog>
@@ -63,10 +72,18 @@
 #include <QDir>
 #include <QLineEdit>
 #include <QTextEdit>
+#include <QThread>
+#include <QAtomicInt>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QImage>
+#include <QHash>
+#include <QElapsedTimer>
+#include <QPointer>
 
 #include "virtual_oss/virtual_oss.h"
 
-#define	MAX_VOLUME_BAR 128
 #define	MAX_MASTER_CHN 64
 
 enum {
@@ -91,9 +108,99 @@ enum {
     (obj)->blockSignals(0);		\
 } while (0)
 
+/* Monotonic time in microseconds, for all latency and timing stats */
+static inline uint64_t
+voss_usec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * 1000000ULL +
+	    (uint64_t)ts.tv_nsec / 1000ULL);
+}
+
+/* time histogram buckets, bucket N holds [2**(N-1), 2**N) us */
+#define	VOSS_HIST_BUCKETS 24
+
+struct VOSSHistogram {
+	uint32_t hist[VOSS_HIST_BUCKETS];
+	uint64_t count;
+	uint64_t sum_usec;
+	uint32_t max_usec;
+};
+
+static inline void
+voss_hist_add(VOSSHistogram &st, uint64_t usec)
+{
+	uint64_t delta = usec;
+	int bucket;
+
+	for (bucket = 0; bucket != VOSS_HIST_BUCKETS - 1 && delta != 0; bucket++)
+		delta /= 2;
+
+	st.hist[bucket]++;
+	st.count++;
+	st.sum_usec += usec;
+	if (usec > st.max_usec)
+		st.max_usec = (usec > UINT32_MAX) ? UINT32_MAX : usec;
+}
+
+/* Upper bound of the "pct" percentile time, in microseconds */
+static inline uint32_t
+voss_hist_percentile(const VOSSHistogram &st, int pct)
+{
+	const uint64_t limit = (st.count * pct + 99) / 100;
+	uint64_t sum = 0;
+	int x;
+
+	if (st.count == 0)
+		return (0);
+
+	for (x = 0; x != VOSS_HIST_BUCKETS - 1; x++) {
+		sum += st.hist[x];
+		if (sum >= limit)
+			break;
+	}
+	return (1U << x);
+}
+
+#ifdef VOSS_DEBUG_ALLOC
+/* bytes allocated by repaint requests, see VOSSMainWindow::handle_watchdog() */
+extern uint64_t voss_repaint_bytes;
+extern int voss_repaint_depth;
+
+static inline uint64_t
+voss_alloc_bytes(void)
+{
+	uint64_t value = 0;
+	size_t len = sizeof(value);
+
+	/* bytes allocated by the calling thread, never decreasing */
+	if (mallctl("thread.allocated", &value, &len, NULL, 0) != 0)
+		return (0);
+	return (value);
+}
+
+/* run "what", which requests a repaint, and account its allocations */
+#define	VOSS_DEBUG_REPAINT(what) do {				\
+	const uint64_t voss_before = voss_alloc_bytes();	\
+	voss_repaint_depth++;					\
+	what;							\
+	if (--voss_repaint_depth == 0)				\
+		voss_repaint_bytes += voss_alloc_bytes() - voss_before; \
+} while (0)
+#else
+#define	VOSS_DEBUG_REPAINT(what) do {				\
+	what;							\
+} while (0)
+#endif
+
+class VOSSBackend;
 class VOSSButton;
 class VOSSButton;
 class VOSSButtonMap;
+class VOSSChannel;
 class VOSSCompressor;
 class VOSSConnect;
 class VOSSController;
@@ -101,6 +208,14 @@ class VOSSEqualizer;
 class VOSSGridLayout;
 class VOSSGroupBox;
 class VOSSMainWindow;
+class VOSSMeterBridge;
+class VOSSMeterRaster;
+class VOSSPollSnapshot;
+class VOSSPoller;
+class VOSSSession;
+struct VOSSPeak;
+struct VOSSPollSlot;
+class VOSSStripList;
 class VOSSVolume;
 
 #endif		/* _VIRTUAL_OSS_CTL_H_ */
@@ -6,6 +6,7 @@ QT		+= core gui widgets
 CONFIG		+= qt warn_on release
 
 HEADERS		+= virtual_oss_ctl.h
+HEADERS		+= virtual_oss_ctl_backend.h
 HEADERS		+= virtual_oss_ctl_compressor.h
 HEADERS		+= virtual_oss_ctl_connect.h
 HEADERS         += virtual_oss_ctl_button.h
@@ -13,10 +14,21 @@ HEADERS         += virtual_oss_ctl_buttonmap.h
 HEADERS         += virtual_oss_ctl_equalizer.h
 HEADERS         += virtual_oss_ctl_groupbox.h
 HEADERS         += virtual_oss_ctl_gridlayout.h
+HEADERS         += virtual_oss_ctl_io.h
 HEADERS         += virtual_oss_ctl_mainwindow.h
+HEADERS         += virtual_oss_ctl_meterbridge.h
+HEADERS         += virtual_oss_ctl_poller.h
+HEADERS         += virtual_oss_ctl_profile.h
+HEADERS         += virtual_oss_ctl_session.h
+HEADERS         += virtual_oss_ctl_stall.h
+HEADERS         += virtual_oss_ctl_state.h
+HEADERS         += virtual_oss_ctl_striplist.h
+HEADERS         += virtual_oss_ctl_topology.h
+HEADERS         += virtual_oss_ctl_trace.h
 HEADERS         += virtual_oss_ctl_volume.h
 
 SOURCES		+= virtual_oss_ctl.cpp
+SOURCES		+= virtual_oss_ctl_backend.cpp
 SOURCES		+= virtual_oss_ctl_compressor.cpp
 SOURCES		+= virtual_oss_ctl_connect.cpp
 SOURCES         += virtual_oss_ctl_button.cpp
@@ -24,7 +36,17 @@ SOURCES         += virtual_oss_ctl_buttonmap.cpp
 SOURCES         += virtual_oss_ctl_equalizer.cpp
 SOURCES         += virtual_oss_ctl_groupbox.cpp
 SOURCES         += virtual_oss_ctl_gridlayout.cpp
+SOURCES         += virtual_oss_ctl_io.cpp
 SOURCES         += virtual_oss_ctl_mainwindow.cpp
+SOURCES         += virtual_oss_ctl_meterbridge.cpp
+SOURCES         += virtual_oss_ctl_poller.cpp
+SOURCES         += virtual_oss_ctl_profile.cpp
+SOURCES         += virtual_oss_ctl_session.cpp
+SOURCES         += virtual_oss_ctl_stall.cpp
+SOURCES         += virtual_oss_ctl_state.cpp
+SOURCES         += virtual_oss_ctl_striplist.cpp
+SOURCES         += virtual_oss_ctl_topology.cpp
+SOURCES         += virtual_oss_ctl_trace.cpp
 SOURCES         += virtual_oss_ctl_volume.cpp
 
 RESOURCES	+= virtual_oss_ctl.qrc
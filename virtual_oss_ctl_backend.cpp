@@ -0,0 +1,512 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_backend.h"
+#include "virtual_oss_ctl_trace.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#ifndef VIRTUAL_OSS_VERSION
+#define	VIRTUAL_OSS_VERSION 0
+#endif
+
+/*
+ * Create the backend for a control device name. Returns NULL if a
+ * simulator specification cannot be parsed or a trace cannot be
+ * loaded.
+ */
+VOSSBackend *
+VOSSBackend :: create(const char *path)
+{
+	VOSSSimConfig cfg;
+
+	if (strncmp(path, VOSS_REPLAY_PREFIX, strlen(VOSS_REPLAY_PREFIX)) == 0)
+		return (VOSSTraceReplay::create(path + strlen(VOSS_REPLAY_PREFIX), 0));
+	if (strncmp(path, VOSS_REPLAY_FAST_PREFIX, strlen(VOSS_REPLAY_FAST_PREFIX)) == 0)
+		return (VOSSTraceReplay::create(path + strlen(VOSS_REPLAY_FAST_PREFIX), 1));
+
+	if (strncmp(path, VOSS_SIM_PREFIX, strlen(VOSS_SIM_PREFIX)) != 0)
+		return (new VOSSDeviceBackend());
+
+	if (VOSSSimBackend::parse(path + strlen(VOSS_SIM_PREFIX), cfg) != 0)
+		return (0);
+
+	return (new VOSSSimBackend(cfg));
+}
+
+int
+VOSSDeviceBackend :: open(const char *path)
+{
+	return (::open(path, O_RDWR));
+}
+
+void
+VOSSDeviceBackend :: close(int fd)
+{
+	::close(fd);
+}
+
+int
+VOSSDeviceBackend :: ioctl(int fd, unsigned long cmd, void *arg)
+{
+	return (::ioctl(fd, cmd, arg));
+}
+
+/*
+ * Parse a comma separated list of "key=value" pairs. Keys which are
+ * not given keep their default. Returns non-zero on error.
+ */
+int
+VOSSSimBackend :: parse(const char *spec, VOSSSimConfig &cfg)
+{
+	static const struct {
+		const char *key;
+		size_t offset;
+		int min;
+		int max;
+	} keys[] = {
+#define	VOSS_SIM_KEY(k, f, a, b) { k, offsetof(VOSSSimConfig, f), a, b }
+		VOSS_SIM_KEY("dev", devices, 0, 65535),
+		VOSS_SIM_KEY("loop", loopbacks, 0, 65535),
+		VOSS_SIM_KEY("chans", channels, 1, 64),
+		VOSS_SIM_KEY("imon", input_mons, 0, 65535),
+		VOSS_SIM_KEY("omon", output_mons, 0, 65535),
+		VOSS_SIM_KEY("lmon", local_mons, 0, 65535),
+		VOSS_SIM_KEY("master", masters, 0, 64),
+		VOSS_SIM_KEY("fir", filter_size, 0, VIRTUAL_OSS_FILTER_MAX),
+		VOSS_SIM_KEY("rate", sample_rate, 8000, 384000),
+		VOSS_SIM_KEY("bits", bits, 8, 32),
+		VOSS_SIM_KEY("latency", latency_usec, 0, 10000000),
+#undef VOSS_SIM_KEY
+	};
+	const char *end;
+	char *ep;
+	size_t len;
+	long value;
+	size_t x;
+
+	cfg.devices = 1;
+	cfg.loopbacks = 1;
+	cfg.channels = 2;
+	cfg.input_mons = 1;
+	cfg.output_mons = 1;
+	cfg.local_mons = 1;
+	cfg.masters = 2;
+	cfg.filter_size = 256;
+	cfg.sample_rate = 48000;
+	cfg.bits = 32;
+	cfg.latency_usec = 0;
+
+	while (*spec != 0) {
+		end = strchr(spec, '=');
+		if (end == NULL)
+			return (-1);
+		len = end - spec;
+
+		for (x = 0; x != sizeof(keys) / sizeof(keys[0]); x++) {
+			if (strlen(keys[x].key) == len &&
+			    strncmp(keys[x].key, spec, len) == 0)
+				break;
+		}
+		if (x == sizeof(keys) / sizeof(keys[0]))
+			return (-1);
+
+		value = strtol(end + 1, &ep, 0);
+		if (ep == end + 1 || (*ep != ',' && *ep != 0) ||
+		    value < keys[x].min || value > keys[x].max)
+			return (-1);
+
+		*(int *)((char *)&cfg + keys[x].offset) = value;
+
+		spec = (*ep == ',') ? ep + 1 : ep;
+	}
+	return (0);
+}
+
+VOSSSimBackend :: VOSSSimBackend(const VOSSSimConfig &_cfg)
+{
+	const int n_io = (_cfg.devices + _cfg.loopbacks) * _cfg.channels;
+	int count[3];
+	int x;
+	int y;
+
+	cfg = _cfg;
+
+	io.resize(n_io);
+	for (x = 0; x != n_io; x++) {
+		struct virtual_oss_io_info &info = io[x];
+		const int number = x / cfg.channels;
+
+		memset(&info, 0, sizeof(info));
+		if (number < cfg.devices) {
+			info.number = number;
+			snprintf(info.name, sizeof(info.name), "sim.dev%d", number);
+		} else {
+			info.number = number - cfg.devices;
+			snprintf(info.name, sizeof(info.name), "sim.loop%d", info.number);
+		}
+		info.channel = x % cfg.channels;
+		info.bits = cfg.bits;
+		info.rx_chan = info.channel;
+		info.tx_chan = info.channel;
+	}
+
+	io_limit.resize(cfg.devices + cfg.loopbacks);
+	for (x = 0; x != io_limit.size(); x++)
+		memset(&io_limit[x], 0, sizeof(io_limit[x]));
+
+	/* all filters start out as a unit impulse */
+	fir.resize(2 * n_io);
+	for (x = 0; x != fir.size(); x++) {
+		fir[x].fill(0.0, cfg.filter_size);
+		if (cfg.filter_size != 0)
+			fir[x][0] = 1.0;
+	}
+
+	count[0] = cfg.input_mons;
+	count[1] = cfg.output_mons;
+	count[2] = cfg.local_mons;
+	for (y = 0; y != 3; y++) {
+		mon[y].resize(count[y]);
+		for (x = 0; x != count[y]; x++) {
+			struct virtual_oss_mon_info &info = mon[y][x];
+
+			memset(&info, 0, sizeof(info));
+			info.number = x;
+			info.bits = cfg.bits;
+			info.src_chan = x % cfg.channels;
+			info.dst_chan = x % cfg.channels;
+		}
+	}
+
+	memset(&output_limit, 0, sizeof(output_limit));
+	memset(&locator, 0, sizeof(locator));
+	locator.signal_delay_hz = cfg.sample_rate;
+
+	recording = 0;
+	next_handle = VOSS_SIM_FD_BASE;
+	start_usec = voss_usec();
+}
+
+int
+VOSSSimBackend :: open(const char *path)
+{
+	QMutexLocker locker(&lock);
+
+	handles.append(next_handle);
+	return (next_handle++);
+}
+
+void
+VOSSSimBackend :: close(int fd)
+{
+	QMutexLocker locker(&lock);
+
+	handles.removeOne(fd);
+}
+
+int
+VOSSSimBackend :: ioctl(int fd, unsigned long cmd, void *arg)
+{
+	int error;
+
+	/* simulate the round trip, concurrent requests overlap */
+	if (cfg.latency_usec != 0)
+		usleep(cfg.latency_usec);
+
+	lock.lock();
+	if (handles.contains(fd))
+		error = request(cmd, arg);
+	else
+		error = EBADF;
+	lock.unlock();
+
+	if (error != 0) {
+		errno = error;
+		return (-1);
+	}
+	return (0);
+}
+
+/* Index of a device or loopback channel, or -1 if there is none */
+int
+VOSSSimBackend :: io_index(int type, int number, int channel) const
+{
+	const int count = (type == VOSS_TYPE_DEVICE) ? cfg.devices : cfg.loopbacks;
+
+	if (number < 0 || number >= count || channel < 0 || channel >= cfg.channels)
+		return (-1);
+	if (type == VOSS_TYPE_LOOPBACK)
+		number += cfg.devices;
+	return (number * cfg.channels + channel);
+}
+
+/* Synthetic peak level, a slow waveform which differs per "seed" */
+int64_t
+VOSSSimBackend :: peak(int seed, int phase, int bits) const
+{
+	const double t = (voss_usec() - start_usec) / 1000000.0;
+	const double f = 0.25 + 0.13 * (seed % 7);
+	const double v = sin(2.0 * M_PI * f * t + 0.7 * seed + 1.3 * phase);
+
+	return ((int64_t)(v * v * (double)((1LL << (bits - 1)) - 1)));
+}
+
+/* Handle a single request with the lock held, returns an errno value */
+int
+VOSSSimBackend :: request(unsigned long cmd, void *arg)
+{
+	struct virtual_oss_io_info *pi;
+	struct virtual_oss_mon_info *pm;
+	struct virtual_oss_io_peak *pip;
+	struct virtual_oss_mon_peak *pmp;
+	struct virtual_oss_master_peak *pmaster;
+	struct virtual_oss_io_limit *pl;
+	struct virtual_oss_fir_filter *pf;
+	struct virtual_oss_system_info *ps;
+	struct virtual_oss_audio_delay_locator *pa;
+	int type;
+	int kind;
+	int x;
+
+	switch (cmd) {
+	case VIRTUAL_OSS_GET_VERSION:
+		*(int *)arg = VIRTUAL_OSS_VERSION;
+		return (0);
+	case VIRTUAL_OSS_GET_SAMPLE_RATE:
+		*(int *)arg = cfg.sample_rate;
+		return (0);
+	case VIRTUAL_OSS_GET_SYSTEM_INFO:
+		ps = (struct virtual_oss_system_info *)arg;
+		memset(ps, 0, sizeof(*ps));
+		ps->sample_rate = cfg.sample_rate;
+		ps->sample_bits = cfg.bits;
+		ps->sample_channels = cfg.channels;
+		strlcpy(ps->rx_device_name, "simulator", sizeof(ps->rx_device_name));
+		strlcpy(ps->tx_device_name, "simulator", sizeof(ps->tx_device_name));
+		return (0);
+	case VIRTUAL_OSS_ADD_OPTIONS:
+		/* the simulated topology is fixed */
+		return (EOPNOTSUPP);
+	case VIRTUAL_OSS_GET_RECORDING:
+		*(int *)arg = recording;
+		return (0);
+	case VIRTUAL_OSS_SET_RECORDING:
+		recording = (*(int *)arg != 0);
+		return (0);
+
+	case VIRTUAL_OSS_GET_DEV_INFO:
+	case VIRTUAL_OSS_GET_LOOP_INFO:
+	case VIRTUAL_OSS_SET_DEV_INFO:
+	case VIRTUAL_OSS_SET_LOOP_INFO:
+		pi = (struct virtual_oss_io_info *)arg;
+		type = (cmd == VIRTUAL_OSS_GET_DEV_INFO || cmd == VIRTUAL_OSS_SET_DEV_INFO) ?
+		    VOSS_TYPE_DEVICE : VOSS_TYPE_LOOPBACK;
+		x = io_index(type, pi->number, pi->channel);
+		if (x < 0)
+			return (EINVAL);
+		if (cmd == VIRTUAL_OSS_GET_DEV_INFO || cmd == VIRTUAL_OSS_GET_LOOP_INFO) {
+			*pi = io[x];
+			return (0);
+		}
+		io[x].rx_amp = pi->rx_amp;
+		io[x].tx_amp = pi->tx_amp;
+		io[x].rx_chan = pi->rx_chan;
+		io[x].tx_chan = pi->tx_chan;
+		io[x].rx_mute = pi->rx_mute;
+		io[x].tx_mute = pi->tx_mute;
+		io[x].rx_pol = pi->rx_pol;
+		io[x].tx_pol = pi->tx_pol;
+		io[x].rx_delay = pi->rx_delay;
+		return (0);
+
+	case VIRTUAL_OSS_GET_INPUT_MON_INFO:
+	case VIRTUAL_OSS_GET_OUTPUT_MON_INFO:
+	case VIRTUAL_OSS_GET_LOCAL_MON_INFO:
+	case VIRTUAL_OSS_SET_INPUT_MON_INFO:
+	case VIRTUAL_OSS_SET_OUTPUT_MON_INFO:
+	case VIRTUAL_OSS_SET_LOCAL_MON_INFO:
+		pm = (struct virtual_oss_mon_info *)arg;
+		kind = (cmd == VIRTUAL_OSS_GET_INPUT_MON_INFO ||
+		    cmd == VIRTUAL_OSS_SET_INPUT_MON_INFO) ? 0 :
+		    (cmd == VIRTUAL_OSS_GET_OUTPUT_MON_INFO ||
+		    cmd == VIRTUAL_OSS_SET_OUTPUT_MON_INFO) ? 1 : 2;
+		if (pm->number < 0 || pm->number >= mon[kind].size())
+			return (EINVAL);
+		if (cmd == VIRTUAL_OSS_GET_INPUT_MON_INFO ||
+		    cmd == VIRTUAL_OSS_GET_OUTPUT_MON_INFO ||
+		    cmd == VIRTUAL_OSS_GET_LOCAL_MON_INFO) {
+			*pm = mon[kind][pm->number];
+			return (0);
+		}
+		if (pm->src_chan < 0 || pm->src_chan >= cfg.channels ||
+		    pm->dst_chan < 0 || pm->dst_chan >= cfg.channels)
+			return (EINVAL);
+		mon[kind][pm->number].src_chan = pm->src_chan;
+		mon[kind][pm->number].dst_chan = pm->dst_chan;
+		mon[kind][pm->number].pol = pm->pol;
+		mon[kind][pm->number].mute = pm->mute;
+		mon[kind][pm->number].amp = pm->amp;
+		return (0);
+
+	case VIRTUAL_OSS_GET_DEV_PEAK:
+	case VIRTUAL_OSS_GET_LOOP_PEAK:
+		pip = (struct virtual_oss_io_peak *)arg;
+		type = (cmd == VIRTUAL_OSS_GET_DEV_PEAK) ?
+		    VOSS_TYPE_DEVICE : VOSS_TYPE_LOOPBACK;
+		x = io_index(type, pip->number, pip->channel);
+		if (x < 0)
+			return (EINVAL);
+		pip->bits = cfg.bits;
+		pip->rx_peak_value = io[x].rx_mute ? 0 : peak(x, 0, cfg.bits);
+		pip->tx_peak_value = io[x].tx_mute ? 0 : peak(x, 1, cfg.bits);
+		return (0);
+
+	case VIRTUAL_OSS_GET_INPUT_MON_PEAK:
+	case VIRTUAL_OSS_GET_OUTPUT_MON_PEAK:
+	case VIRTUAL_OSS_GET_LOCAL_MON_PEAK:
+		pmp = (struct virtual_oss_mon_peak *)arg;
+		kind = (cmd == VIRTUAL_OSS_GET_INPUT_MON_PEAK) ? 0 :
+		    (cmd == VIRTUAL_OSS_GET_OUTPUT_MON_PEAK) ? 1 : 2;
+		if (pmp->number < 0 || pmp->number >= mon[kind].size())
+			return (EINVAL);
+		pmp->bits = cfg.bits;
+		pmp->peak_value = mon[kind][pmp->number].mute ? 0 :
+		    peak(100000 + kind * 10000 + pmp->number, 0, cfg.bits);
+		return (0);
+
+	case VIRTUAL_OSS_GET_OUTPUT_PEAK:
+	case VIRTUAL_OSS_GET_INPUT_PEAK:
+		pmaster = (struct virtual_oss_master_peak *)arg;
+		if (pmaster->channel < 0 || pmaster->channel >= cfg.masters)
+			return (EINVAL);
+		pmaster->bits = cfg.bits;
+		pmaster->peak_value = peak(200000 + pmaster->channel,
+		    (cmd == VIRTUAL_OSS_GET_OUTPUT_PEAK), cfg.bits);
+		return (0);
+
+	case VIRTUAL_OSS_GET_DEV_LIMIT:
+	case VIRTUAL_OSS_GET_LOOP_LIMIT:
+	case VIRTUAL_OSS_SET_DEV_LIMIT:
+	case VIRTUAL_OSS_SET_LOOP_LIMIT:
+		pl = (struct virtual_oss_io_limit *)arg;
+		x = pl->number;
+		if (cmd == VIRTUAL_OSS_GET_LOOP_LIMIT || cmd == VIRTUAL_OSS_SET_LOOP_LIMIT) {
+			if (x < 0 || x >= cfg.loopbacks)
+				return (EINVAL);
+			x += cfg.devices;
+		} else if (x < 0 || x >= cfg.devices) {
+			return (EINVAL);
+		}
+		if (cmd == VIRTUAL_OSS_SET_DEV_LIMIT || cmd == VIRTUAL_OSS_SET_LOOP_LIMIT) {
+			io_limit[x] = pl->param;
+			return (0);
+		}
+		pl->param = io_limit[x];
+		/* the gain follows the first channel of the device */
+		pl->param.gain = pl->param.enabled ?
+		    1000 - peak(x * cfg.channels, 0, 10) : 1000;
+		return (0);
+
+	case VIRTUAL_OSS_GET_OUTPUT_LIMIT:
+		*(struct virtual_oss_compressor *)arg = output_limit;
+		((struct virtual_oss_compressor *)arg)->gain = output_limit.enabled ?
+		    1000 - peak(200000, 1, 10) : 1000;
+		return (0);
+	case VIRTUAL_OSS_SET_OUTPUT_LIMIT:
+		output_limit = *(struct virtual_oss_compressor *)arg;
+		return (0);
+
+	case VIRTUAL_OSS_GET_RX_DEV_FIR_FILTER:
+	case VIRTUAL_OSS_GET_TX_DEV_FIR_FILTER:
+	case VIRTUAL_OSS_GET_RX_LOOP_FIR_FILTER:
+	case VIRTUAL_OSS_GET_TX_LOOP_FIR_FILTER:
+	case VIRTUAL_OSS_SET_RX_DEV_FIR_FILTER:
+	case VIRTUAL_OSS_SET_TX_DEV_FIR_FILTER:
+	case VIRTUAL_OSS_SET_RX_LOOP_FIR_FILTER:
+	case VIRTUAL_OSS_SET_TX_LOOP_FIR_FILTER:
+		pf = (struct virtual_oss_fir_filter *)arg;
+		type = (cmd == VIRTUAL_OSS_GET_RX_DEV_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_GET_TX_DEV_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_SET_RX_DEV_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_SET_TX_DEV_FIR_FILTER) ?
+		    VOSS_TYPE_DEVICE : VOSS_TYPE_LOOPBACK;
+		x = io_index(type, pf->number, pf->channel);
+		if (x < 0 || cfg.filter_size == 0)
+			return (EINVAL);
+		x = 2 * x + (cmd == VIRTUAL_OSS_GET_TX_DEV_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_GET_TX_LOOP_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_SET_TX_DEV_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_SET_TX_LOOP_FIR_FILTER);
+
+		if (cmd == VIRTUAL_OSS_GET_RX_DEV_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_GET_TX_DEV_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_GET_RX_LOOP_FIR_FILTER ||
+		    cmd == VIRTUAL_OSS_GET_TX_LOOP_FIR_FILTER) {
+			/* no buffer queries the filter size */
+			if (pf->filter_data != NULL) {
+				if (pf->filter_size != cfg.filter_size)
+					return (EINVAL);
+				memcpy(pf->filter_data, fir[x].constData(),
+				    sizeof(double) * cfg.filter_size);
+			}
+			pf->filter_size = cfg.filter_size;
+			return (0);
+		}
+		if (pf->filter_data == NULL) {
+			/* reset to a unit impulse */
+			fir[x].fill(0.0);
+			fir[x][0] = 1.0;
+			return (0);
+		}
+		if (pf->filter_size != cfg.filter_size)
+			return (EINVAL);
+		memcpy(fir[x].data(), pf->filter_data,
+		    sizeof(double) * cfg.filter_size);
+		return (0);
+
+	case VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR:
+		pa = (struct virtual_oss_audio_delay_locator *)arg;
+		/* pretend a 10 ms loop once the locator runs */
+		if (locator.locator_enabled)
+			locator.signal_input_delay = cfg.sample_rate / 100;
+		*pa = locator;
+		return (0);
+	case VIRTUAL_OSS_SET_AUDIO_DELAY_LOCATOR:
+		pa = (struct virtual_oss_audio_delay_locator *)arg;
+		locator.channel_input = pa->channel_input;
+		locator.channel_output = pa->channel_output;
+		locator.signal_output_level = pa->signal_output_level;
+		locator.locator_enabled = pa->locator_enabled;
+		return (0);
+	case VIRTUAL_OSS_RST_AUDIO_DELAY_LOCATOR:
+		locator.signal_input_delay = 0;
+		return (0);
+
+	default:
+		return (ENOTTY);
+	}
+}
@@ -0,0 +1,115 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_BACKEND_H_
+#define	_VOSS_CTL_BACKEND_H_
+
+#include "virtual_oss_ctl.h"
+
+#define	VOSS_SIM_PREFIX "sim:"
+#define	VOSS_SIM_FD_BASE (1 << 24)	/* first simulated handle */
+#define	VOSS_SIM_NAME 64
+
+/*
+ * The control device, as seen by VOSSIo. A backend returns handles
+ * from open() and implements ioctl() with the system call semantics:
+ * -1 and errno on failure. All methods may be called by several
+ * threads at the same time.
+ */
+class VOSSBackend
+{
+public:
+	virtual ~VOSSBackend() {};
+
+	virtual int open(const char *) = 0;
+	virtual void close(int) = 0;
+	virtual int ioctl(int, unsigned long, void *) = 0;
+	virtual void flush(void) {};
+
+	static VOSSBackend *create(const char *);
+};
+
+/* The virtual_oss control device node */
+class VOSSDeviceBackend : public VOSSBackend
+{
+public:
+	int open(const char *);
+	void close(int);
+	int ioctl(int, unsigned long, void *);
+};
+
+struct VOSSSimConfig {
+	int devices;
+	int loopbacks;
+	int channels;		/* per device and loopback */
+	int input_mons;
+	int output_mons;
+	int local_mons;
+	int masters;		/* master input and output channels */
+	int filter_size;	/* FIR filter taps, 0 for none */
+	int sample_rate;
+	int bits;
+	int latency_usec;	/* added to every ioctl */
+};
+
+/*
+ * In-process simulation of a virtual_oss control device with a
+ * configurable topology, selected by "sim:key=value,...". Peaks are
+ * synthetic waveforms of the monotonic clock, different for each
+ * channel, so the meters move without any audio. All other requests
+ * keep their state in memory. Nothing is persisted.
+ */
+class VOSSSimBackend : public VOSSBackend
+{
+public:
+	VOSSSimBackend(const VOSSSimConfig &);
+
+	static int parse(const char *, VOSSSimConfig &);
+
+	int open(const char *);
+	void close(int);
+	int ioctl(int, unsigned long, void *);
+
+private:
+	int request(unsigned long, void *);
+	int io_index(int, int, int) const;
+	int64_t peak(int, int, int) const;
+
+	VOSSSimConfig cfg;
+
+	QMutex lock;
+	QVector<int> handles;
+	QVector<struct virtual_oss_io_info> io;		/* devices, then loopbacks */
+	QVector<struct virtual_oss_compressor> io_limit;
+	QVector<QVector<double> > fir;			/* rx then tx, per io channel */
+	QVector<struct virtual_oss_mon_info> mon[3];	/* input, output, local */
+	struct virtual_oss_compressor output_limit;
+	struct virtual_oss_audio_delay_locator locator;
+	int recording;
+	int next_handle;
+	uint64_t start_usec;
+};
+
+#endif		/* _VOSS_CTL_BACKEND_H_ */
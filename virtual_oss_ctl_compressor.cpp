@@ -24,10 +24,12 @@
  */
 
 #include "virtual_oss_ctl_compressor.h"
+#include "virtual_oss_ctl_io.h"
 #include "virtual_oss_ctl_mainwindow.h"
+#include "virtual_oss_ctl_stall.h"
 
 VOSSCompressor :: VOSSCompressor(VOSSMainWindow *_parent,
-    int _type, int _num, int _channel, const char *name)
+    int _type, int _num, int _channel, int _slot, const char *name)
 {
 	QPushButton *pb;
 
@@ -35,6 +37,7 @@ VOSSCompressor :: VOSSCompressor(VOSSMainWindow *_parent,
 	type = _type;
 	num = _num;
 	channel = _channel;
+	slot = _slot;
 
 	setWindowTitle(QString("Virtual OSS Compressor for %1").arg(name));
 	setWindowIcon(QIcon(QString(":/virtual_oss_ctl.png")));
@@ -44,6 +47,7 @@ VOSSCompressor :: VOSSCompressor(VOSSMainWindow *_parent,
 	gl->addWidget(new QLabel(tr("Current gain")), 0,0,1,1);
 	lbl_gain = new QLabel("1.0");
 	gl->addWidget(lbl_gain, 0,1,1,1);
+	gain_shown = 1000;
 
 	gl->addWidget(new QLabel(tr("Enabled")), 1,0,1,1);
 	spn_enabled = new QSpinBox();
@@ -99,34 +103,46 @@ VOSSCompressor :: get_values(const virtual_oss_compressor *ptr)
 void
 VOSSCompressor :: get_values(void)
 {
-	if (parent->dsp_fd < 0)
+	struct virtual_oss_compressor out_limit;
+	struct virtual_oss_io_limit io_limit;
+	int error;
+
+	/* use the write-through cache in the mixer state, if valid */
+	if (parent->state.limit_valid[slot]) {
+		parent->state.get_limit(slot, &out_limit);
+		get_values(&out_limit);
+		return;
+	}
+
+	if (parent->session->fd() < 0)
 		return;
 
 	switch (type) {
-	int error;
 	case VOSS_TYPE_MAIN_OUTPUT:
 		memset(&out_limit, 0, sizeof(out_limit));
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_OUTPUT_LIMIT, &out_limit);
-		if (error == 0)
-			get_values(&out_limit);
+		error = voss_io.ioctl(VOSS_IO_READ, parent->session->fd(), VIRTUAL_OSS_GET_OUTPUT_LIMIT, &out_limit);
 		break;
 	case VOSS_TYPE_DEVICE:
 		memset(&io_limit, 0, sizeof(io_limit));
 		io_limit.number = num;
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_DEV_LIMIT, &io_limit);
-		if (error == 0)
-			get_values(&io_limit.param);
+		error = voss_io.ioctl(VOSS_IO_READ, parent->session->fd(), VIRTUAL_OSS_GET_DEV_LIMIT, &io_limit);
+		out_limit = io_limit.param;
 		break;
 	case VOSS_TYPE_LOOPBACK:
 		memset(&io_limit, 0, sizeof(io_limit));
 		io_limit.number = num;
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_LOOP_LIMIT, &io_limit);
-		if (error == 0)
-			get_values(&io_limit.param);
+		error = voss_io.ioctl(VOSS_IO_READ, parent->session->fd(), VIRTUAL_OSS_GET_LOOP_LIMIT, &io_limit);
+		out_limit = io_limit.param;
 		break;
 	default:
+		error = EINVAL;
 		break;
 	}
+	if (error != 0)
+		return;
+
+	parent->state.set_limit(slot, &out_limit);
+	get_values(&out_limit);
 }
 
 void
@@ -150,40 +166,15 @@ VOSSCompressor :: handle_paste()
 void
 VOSSCompressor :: gain_update(const virtual_oss_compressor *ptr)
 {
-	lbl_gain->setText(QString("%1").arg((double)ptr->gain / (double)1000.0));
-}
+	char buf[16];
 
-void
-VOSSCompressor :: gain_update(void)
-{
-	if (parent->dsp_fd < 0)
+	/* called every watchdog tick, only touch the label on change */
+	if (ptr->gain == gain_shown)
 		return;
+	gain_shown = ptr->gain;
 
-	switch (type) {
-	int error;
-	case VOSS_TYPE_MAIN_OUTPUT:
-		memset(&out_limit, 0, sizeof(out_limit));
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_OUTPUT_LIMIT, &out_limit);
-		if (error == 0)
-			gain_update(&out_limit);
-		break;
-	case VOSS_TYPE_DEVICE:
-		memset(&io_limit, 0, sizeof(io_limit));
-		io_limit.number = num;
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_DEV_LIMIT, &io_limit);
-		if (error == 0)
-			gain_update(&io_limit.param);
-		break;
-	case VOSS_TYPE_LOOPBACK:
-		memset(&io_limit, 0, sizeof(io_limit));
-		io_limit.number = num;
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_LOOP_LIMIT, &io_limit);
-		if (error == 0)
-			gain_update(&io_limit.param);
-		break;
-	default:
-		break;
-	}
+	snprintf(buf, sizeof(buf), "%g", (double)ptr->gain / (double)1000.0);
+	VOSS_DEBUG_REPAINT(lbl_gain->setText(QString(buf)));
 }
 
 void
@@ -199,28 +190,12 @@ VOSSCompressor :: get_param(virtual_oss_compressor *ptr)
 void
 VOSSCompressor :: handle_update()
 {
-	if (parent->dsp_fd < 0)
-		return;
+	VOSS_STALL_MARK("VOSSCompressor::handle_update");
+	struct virtual_oss_compressor out_limit;
 
-	switch (type) {
-	int error;
-	case VOSS_TYPE_MAIN_OUTPUT:
-		get_param(&out_limit);
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_SET_OUTPUT_LIMIT, &out_limit);
-		break;
-	case VOSS_TYPE_DEVICE:
-		memset(&io_limit, 0, sizeof(io_limit));
-		io_limit.number = num;
-		get_param(&io_limit.param);
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_SET_DEV_LIMIT, &io_limit);
-		break;
-	case VOSS_TYPE_LOOPBACK:
-		memset(&io_limit, 0, sizeof(io_limit));
-		io_limit.number = num;
-		get_param(&io_limit.param);
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_SET_LOOP_LIMIT, &io_limit);
-		break;
-	default:
-		break;
-	}
+	get_param(&out_limit);
+	out_limit.gain = parent->state.limit_gain[slot];
+	parent->state.set_limit(slot, &out_limit);
+
+	parent->write_limit(slot);
 }
@@ -34,26 +34,24 @@ class VOSSCompressor : public QWidget
 {
 	Q_OBJECT;
 public:
-	VOSSCompressor(VOSSMainWindow *_parent, int _type, int _num, int _channel, const char *name);
+	VOSSCompressor(VOSSMainWindow *_parent, int _type, int _num, int _channel, int _slot, const char *name);
 	~VOSSCompressor();
 
 	void get_values(const virtual_oss_compressor *);
 	void get_values(void);
 	void gain_update(const virtual_oss_compressor *);
-	void gain_update(void);
   	void get_param(virtual_oss_compressor *);
 
 	int type;
 	int num;
 	int channel;
-
-	struct virtual_oss_compressor out_limit;
-	struct virtual_oss_io_limit io_limit;
+	int slot;
 
 	QGridLayout *gl;
 	VOSSMainWindow *parent;
 
 	QLabel *lbl_gain;
+	int gain_shown;
 	QSpinBox *spn_enabled;
 	QSpinBox *spn_knee;
 	QSpinBox *spn_attack;
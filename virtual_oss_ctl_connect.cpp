@@ -87,7 +87,8 @@ VOSSLoopConnections :: drawNice(QPainter &paint, int src_flag, int src_row,
 void
 VOSSLoopConnections :: paintEvent(QPaintEvent *event)
 {
-	VOSSController *pc;
+	const VOSSMixerState &st = parent->parent->state;
+	VOSSChannel *pc;
 	QPainter paint(this);
 	int w = width();
 	int h = height();
@@ -99,12 +100,14 @@ VOSSLoopConnections :: paintEvent(QPaintEvent *event)
 	paint.fillRect(QRectF(0,0,w,h), Qt::white);
 
 	for (y = 0; y != 2; y++) {
-		for (x = 0; x != MAX_VOLUME_BAR && ((pc = parent->parent->vb[x]) != 0); x++) {
+		for (x = 0; x != parent->parent->vb.size(); x++) {
+			pc = parent->parent->vb[x];
+
 			switch(pc->type) {
 			case VOSS_TYPE_LOOPBACK:
 				drawNice(paint, MIX_RIGHT, pc->connect_row,
-				    MIX_LEFT, pc->io_info.rx_chan + 1,
-				    pc->io_info.rx_mute, y);
+				    MIX_LEFT, st.rx_chan[pc->slot] + 1,
+				    st.rx_mute[pc->slot], y);
 				break;
 			default:
 				break;
@@ -201,7 +204,8 @@ VOSSDevConnections :: getTxRow(int which)
 void
 VOSSDevConnections :: paintEvent(QPaintEvent *event)
 {
-	VOSSController *pc;
+	const VOSSMixerState &st = parent->parent->state;
+	VOSSChannel *pc;
 	QPainter paint(this);
 	int w = width();
 	int h = height();
@@ -213,21 +217,23 @@ VOSSDevConnections :: paintEvent(QPaintEvent *event)
 	paint.fillRect(QRectF(0,0,w,h), Qt::white);
 
 	for (y = 0; y != 2; y++) {
-		for (x = 0; x != MAX_VOLUME_BAR && ((pc = parent->parent->vb[x]) != 0); x++) {
+		for (x = 0; x != parent->parent->vb.size(); x++) {
+			pc = parent->parent->vb[x];
+
 			switch(pc->type) {
 			case VOSS_TYPE_DEVICE:
 				drawNice(paint, MIX_LEFT, pc->connect_row,
-				    MIX_RIGHT, getTxRow(pc->io_info.tx_chan), pc->io_info.tx_mute, y);
-				drawNice(paint, MIX_LEFT, getRxRow(pc->io_info.rx_chan),
-				    MIX_RIGHT, pc->connect_row, pc->io_info.rx_mute, y);
+				    MIX_RIGHT, getTxRow(st.tx_chan[pc->slot]), st.tx_mute[pc->slot], y);
+				drawNice(paint, MIX_LEFT, getRxRow(st.rx_chan[pc->slot]),
+				    MIX_RIGHT, pc->connect_row, st.rx_mute[pc->slot], y);
 				break;
 			case VOSS_TYPE_INPUT_MON:
-				drawNice(paint, MIX_LEFT, getRxRow(pc->mon_info.src_chan),
-				    MIX_RIGHT, getTxRow(pc->mon_info.dst_chan), pc->mon_info.mute, y);
+				drawNice(paint, MIX_LEFT, getRxRow(st.rx_chan[pc->slot]),
+				    MIX_RIGHT, getTxRow(st.tx_chan[pc->slot]), st.rx_mute[pc->slot], y);
 				break;
 			case VOSS_TYPE_OUTPUT_MON:
-				drawNice(paint, MIX_RIGHT, getTxRow(pc->mon_info.src_chan),
-				    MIX_RIGHT, getTxRow(pc->mon_info.dst_chan), pc->mon_info.mute, y);
+				drawNice(paint, MIX_RIGHT, getTxRow(st.rx_chan[pc->slot]),
+				    MIX_RIGHT, getTxRow(st.tx_chan[pc->slot]), st.rx_mute[pc->slot], y);
 				break;
 			default:
 				break;
@@ -238,16 +244,16 @@ VOSSDevConnections :: paintEvent(QPaintEvent *event)
 
 VOSSConnect :: VOSSConnect(VOSSMainWindow *mw)
 {
-	VOSSController *pc;
-	uint32_t x;
-	uint32_t n_row = 1;
-	uint32_t n_loopback = 0;
 	QLabel *lbl;
+	int x;
 
 	parent = mw;
 
 	n_master_input = 0;
 	n_master_output = 0;
+	n_device = 0;
+	n_loopback = 0;
+	n_stretch = 0;
 
 	gl = new QGridLayout(this);
 
@@ -257,83 +263,172 @@ VOSSConnect :: VOSSConnect(VOSSMainWindow *mw)
 	lbl = new QLabel(tr("Main Device Output"));
 	gl->addWidget(lbl, 0, 2, 1, 1);
 
-	for (x = 0; x != MAX_VOLUME_BAR && ((pc = parent->vb[x]) != 0); x++) {
-		switch(pc->type) {
-		case VOSS_TYPE_MAIN_INPUT:
-			pc->connect_row = n_row + n_master_input;
+	for (x = 0; x != parent->vb.size(); x++)
+		insert(parent->vb[x]);
 
-			pc->connect_input_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
-			gl->addWidget(pc->connect_input_label, pc->connect_row, 0, 1, 1);
-			n_master_input++;
-			break;
-		case VOSS_TYPE_MAIN_OUTPUT:
-			pc->connect_row = n_row + n_master_output;
+	devconn = new VOSSDevConnections(this);
+	loopconn = new VOSSLoopConnections(this);
 
-			pc->connect_output_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
-			gl->addWidget(pc->connect_output_label, pc->connect_row, 2, 1, 1);
-			n_master_output++;
-			break;
-		default:
-			break;
+	relayout();
+
+	setTitle(tr("Connection diagram"));
+}
+
+VOSSConnect :: ~VOSSConnect()
+{
+
+}
+
+/*
+ * Create the connection row widgets of a channel. They are put in
+ * place by relayout().
+ */
+void
+VOSSConnect :: insert(VOSSChannel *pc)
+{
+	const char *name = parent->state.name[pc->slot].c_str();
+
+	switch (pc->type) {
+	case VOSS_TYPE_MAIN_INPUT:
+		pc->connect_input_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
+		break;
+	case VOSS_TYPE_MAIN_OUTPUT:
+		pc->connect_output_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
+		break;
+	case VOSS_TYPE_DEVICE:
+		if (pc->channel == 0) {
+			pc->connect_input_title = new QLabel(tr(name) + tr(" - input"));
+			pc->connect_output_title = new QLabel(tr(name) + tr(" - output"));
 		}
+		pc->connect_input_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
+		pc->connect_output_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
+		break;
+	case VOSS_TYPE_LOOPBACK:
+		if (pc->channel == 0)
+			pc->connect_input_title = new QLabel(tr(name) + tr(" - input"));
+		pc->connect_input_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
+		break;
+	default:
+		break;
 	}
+}
 
-	if (n_master_input < n_master_output)
-		n_row += n_master_output;
-	else
-		n_row += n_master_input;
+/* Move a widget to another cell of the grid */
+void
+VOSSConnect :: place(QWidget *w, int row, int column)
+{
+	if (w == 0)
+		return;
+	gl->removeWidget(w);
+	gl->addWidget(w, row, column, 1, 1);
+}
+
+/*
+ * Put the rows of all channels in place, in topology order. The
+ * master rows come first, followed by the device rows. The loopback
+ * rows are in a column of their own. Rows of removed channels are
+ * closed up, and added channels join the rows of their device.
+ */
+void
+VOSSConnect :: relayout(void)
+{
+	QVector<int> order;
+	VOSSChannel *pc;
+	uint32_t n_input = 0;
+	uint32_t n_output = 0;
+	int x;
+
+	parent->slot_order(order);
+
+	n_master_input = 0;
+	n_master_output = 0;
+	for (x = 0; x != order.size(); x++) {
+		pc = parent->vb[order[x]];
+		if (pc->type == VOSS_TYPE_MAIN_INPUT)
+			n_master_input++;
+		else if (pc->type == VOSS_TYPE_MAIN_OUTPUT)
+			n_master_output++;
+	}
 
-	for (x = 0; x != MAX_VOLUME_BAR && ((pc = parent->vb[x]) != 0); x++) {
-		switch(pc->type) {
+	n_device = 1 + ((n_master_input < n_master_output) ?
+	    n_master_output : n_master_input);
+	n_loopback = 0;
+
+	for (x = 0; x != order.size(); x++) {
+		pc = parent->vb[order[x]];
+
+		switch (pc->type) {
+		case VOSS_TYPE_MAIN_INPUT:
+			pc->connect_row = 1 + n_input++;
+			place(pc->connect_input_label, pc->connect_row, 0);
+			break;
+		case VOSS_TYPE_MAIN_OUTPUT:
+			pc->connect_row = 1 + n_output++;
+			place(pc->connect_output_label, pc->connect_row, 2);
+			break;
 		case VOSS_TYPE_DEVICE:
-			if (pc->channel == 0) {
-				gl->addWidget(new QLabel(tr(pc->io_info.name) +
-				    tr(" - input")), n_row, 0, 1, 1);
-				gl->addWidget(new QLabel(tr(pc->io_info.name) +
-				    tr(" - output")), n_row, 2, 1, 1);
-				n_row++;
+			if (pc->connect_input_title != 0) {
+				place(pc->connect_input_title, n_device, 0);
+				place(pc->connect_output_title, n_device, 2);
+				n_device++;
 			}
-			pc->connect_row = n_row;
-			pc->connect_input_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
-			gl->addWidget(pc->connect_input_label, pc->connect_row, 0, 1, 1);
-			pc->connect_output_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
-			gl->addWidget(pc->connect_output_label, pc->connect_row, 2, 1, 1);
-			n_row++;
+			pc->connect_row = n_device++;
+			place(pc->connect_input_label, pc->connect_row, 0);
+			place(pc->connect_output_label, pc->connect_row, 2);
 			break;
 		case VOSS_TYPE_LOOPBACK:
-			if (pc->channel == 0) {
-				gl->addWidget(new QLabel(tr(pc->io_info.name) +
-				    tr(" - input")), n_loopback, 4, 1, 1);
-				n_loopback ++;
-			}
-
-			pc->connect_row = n_loopback;
-			pc->connect_input_label = new QLineEdit(QString("Channel %1").arg(pc->channel));
-			gl->addWidget(pc->connect_input_label, pc->connect_row, 4, 1, 1);
-			n_loopback++;
+			if (pc->connect_input_title != 0)
+				place(pc->connect_input_title, n_loopback++, 4);
+			pc->connect_row = n_loopback++;
+			place(pc->connect_input_label, pc->connect_row, 4);
 			break;
 		default:
 			break;
 		}
 	}
 
+	respan();
+}
+
+/* Tear down the connection rows of a channel */
+void
+VOSSConnect :: remove(VOSSChannel *pc)
+{
+	delete pc->connect_input_title;
+	delete pc->connect_output_title;
+	delete pc->connect_input_label;
+	delete pc->connect_output_label;
+
+	pc->connect_input_title = 0;
+	pc->connect_output_title = 0;
+	pc->connect_input_label = 0;
+	pc->connect_output_label = 0;
+	pc->connect_row = 0;
+}
+
+/* Stretch the connection painters over all rows */
+void
+VOSSConnect :: respan(void)
+{
+	uint32_t n_row = n_device;
+
 	if (n_row < n_loopback)
 		n_row = n_loopback;
+	if (n_row < 2)
+		n_row = 2;
 
-	devconn = new VOSSDevConnections(this);
+	gl->removeWidget(devconn);
 	gl->addWidget(devconn, 1, 1, n_row - 1, 1);
 
-	loopconn = new VOSSLoopConnections(this);
+	gl->removeWidget(loopconn);
 	gl->addWidget(loopconn, 1, 3, n_row - 1, 1);
 
 	gl->setColumnStretch(1, 1);
 	gl->setColumnStretch(2, 1);
+	gl->setRowStretch(n_stretch, 0);
 	gl->setRowStretch(n_row + 1, 1);
+	n_stretch = n_row + 1;
 
-	setTitle(tr("Connection diagram"));
-}
-
-VOSSConnect :: ~VOSSConnect()
-{
-
+	devconn->update();
+	loopconn->update();
 }
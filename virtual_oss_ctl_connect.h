@@ -70,6 +70,12 @@ public:
 	VOSSConnect(VOSSMainWindow *);
 	~VOSSConnect();
 
+	void insert(VOSSChannel *);
+	void remove(VOSSChannel *);
+	void relayout(void);
+	void place(QWidget *, int, int);
+	void respan(void);
+
 	VOSSMainWindow *parent;
 	QGridLayout *gl;
 	VOSSDevConnections *devconn;
@@ -77,6 +83,11 @@ public:
 
 	uint32_t n_master_input;
 	uint32_t n_master_output;
+
+	/* rows used by the device and loopback columns */
+	uint32_t n_device;
+	uint32_t n_loopback;
+	uint32_t n_stretch;
 };
 
 #endif		/* _VIRTUAL_OSS_CTL_CONNECT_H_ */
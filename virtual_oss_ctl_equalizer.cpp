@@ -27,7 +27,9 @@
 #include "virtual_oss_ctl_buttonmap.h"
 #include "virtual_oss_ctl_equalizer.h"
 #include "virtual_oss_ctl_groupbox.h"
+#include "virtual_oss_ctl_io.h"
 #include "virtual_oss_ctl_mainwindow.h"
+#include "virtual_oss_ctl_stall.h"
 #include "virtual_oss_ctl_volume.h"
 
 #include <fftw3.h>
@@ -212,16 +214,16 @@ voss_get_fir_filter(int fd, int type, int num, int channel, double *data, int si
 
 	switch (type) {
 	case VOSS_TYPE_DEVICE | VOSS_TYPE_RX:
-		error = ::ioctl(fd, VIRTUAL_OSS_GET_RX_DEV_FIR_FILTER, &fir);
+		error = voss_io.ioctl(VOSS_IO_READ, fd, VIRTUAL_OSS_GET_RX_DEV_FIR_FILTER, &fir);
 		break;
 	case VOSS_TYPE_LOOPBACK | VOSS_TYPE_RX:
-		error = ::ioctl(fd, VIRTUAL_OSS_GET_RX_LOOP_FIR_FILTER, &fir);
+		error = voss_io.ioctl(VOSS_IO_READ, fd, VIRTUAL_OSS_GET_RX_LOOP_FIR_FILTER, &fir);
 		break;
 	case VOSS_TYPE_DEVICE | VOSS_TYPE_TX:
-		error = ::ioctl(fd, VIRTUAL_OSS_GET_TX_DEV_FIR_FILTER, &fir);
+		error = voss_io.ioctl(VOSS_IO_READ, fd, VIRTUAL_OSS_GET_TX_DEV_FIR_FILTER, &fir);
 		break;
 	case VOSS_TYPE_LOOPBACK | VOSS_TYPE_TX:
-		error = ::ioctl(fd, VIRTUAL_OSS_GET_TX_LOOP_FIR_FILTER, &fir);
+		error = voss_io.ioctl(VOSS_IO_READ, fd, VIRTUAL_OSS_GET_TX_LOOP_FIR_FILTER, &fir);
 		break;
 	default:
 		error = -1;
@@ -246,16 +248,16 @@ voss_set_fir_filter(int fd, int type, int num, int channel, double *data, int si
 
 	switch (type) {
 	case VOSS_TYPE_DEVICE | VOSS_TYPE_RX:
-		error = ::ioctl(fd, VIRTUAL_OSS_SET_RX_DEV_FIR_FILTER, &fir);
+		error = voss_io.ioctl(VOSS_IO_WRITE, fd, VIRTUAL_OSS_SET_RX_DEV_FIR_FILTER, &fir);
 		break;
 	case VOSS_TYPE_LOOPBACK | VOSS_TYPE_RX:
-		error = ::ioctl(fd, VIRTUAL_OSS_SET_RX_LOOP_FIR_FILTER, &fir);
+		error = voss_io.ioctl(VOSS_IO_WRITE, fd, VIRTUAL_OSS_SET_RX_LOOP_FIR_FILTER, &fir);
 		break;
 	case VOSS_TYPE_DEVICE | VOSS_TYPE_TX:
-		error = ::ioctl(fd, VIRTUAL_OSS_SET_TX_DEV_FIR_FILTER, &fir);
+		error = voss_io.ioctl(VOSS_IO_WRITE, fd, VIRTUAL_OSS_SET_TX_DEV_FIR_FILTER, &fir);
 		break;
 	case VOSS_TYPE_LOOPBACK | VOSS_TYPE_TX:
-		error = ::ioctl(fd, VIRTUAL_OSS_SET_TX_LOOP_FIR_FILTER, &fir);
+		error = voss_io.ioctl(VOSS_IO_WRITE, fd, VIRTUAL_OSS_SET_TX_LOOP_FIR_FILTER, &fir);
 		break;
 	default:
 		error = -1;
@@ -395,6 +397,7 @@ VOSSEQFreqResponse :: get_amplitude(int band, double &freq, double &ret)
 void
 VOSSEQFreqResponse :: paintEvent(QPaintEvent *)
 {
+	VOSS_STALL_MARK("VOSSEQFreqResponse::paintEvent");
 	int w = width();
 	int h = height();
 
@@ -501,6 +504,20 @@ VOSSEqualizer :: ~VOSSEqualizer()
 {
 	if (parent->eq_copy == this)
 		parent->eq_copy = 0;
+	free(filter_data);
+}
+
+/*
+ * Return the FIR filter size without transferring any coefficients,
+ * so that the caller can decide whether an equalizer is available
+ * before creating its window.
+ */
+int
+VOSSEqualizer :: probe(int fd, int type, int num, int channel)
+{
+	if (fd < 0)
+		return (0);
+	return (voss_get_fir_filter(fd, type, num, channel, 0, 0));
 }
 
 void
@@ -511,17 +528,17 @@ VOSSEqualizer :: get_filter()
 	sample_rate = 0;
 	filter_size = 0;
 
-	if (parent->dsp_fd < 0)
+	if (parent->session->fd() < 0)
 		return;
 
-	::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_SAMPLE_RATE, &sample_rate);
+	voss_io.ioctl(VOSS_IO_READ, parent->session->fd(), VIRTUAL_OSS_GET_SAMPLE_RATE, &sample_rate);
 
-	filter_size = voss_get_fir_filter(parent->dsp_fd, type, num, channel, 0, 0);
+	filter_size = voss_get_fir_filter(parent->session->fd(), type, num, channel, 0, 0);
 
 	if (filter_size != 0) {
 		filter_data = (double *)malloc(sizeof(double) * filter_size);
 
-		if (voss_get_fir_filter(parent->dsp_fd, type, num, channel,
+		if (voss_get_fir_filter(parent->session->fd(), type, num, channel,
 		    filter_data, filter_size) != filter_size) {
 			free(filter_data);
 			filter_data = 0;
@@ -553,7 +570,9 @@ VOSSEqualizer :: handle_paste()
 void
 VOSSEqualizer :: handle_update()
 {
-	if (filter_size <= 0 || sample_rate <= 0 || parent->dsp_fd < 0)
+	VOSS_STALL_MARK("VOSSEqualizer::handle_update");
+
+	if (filter_size <= 0 || sample_rate <= 0 || parent->session->fd() < 0)
 		return;
 
 	if (onoff->currSelection == 0) {
@@ -599,6 +618,6 @@ VOSSEqualizer :: handle_update()
 		}
 	}
 
-	voss_set_fir_filter(parent->dsp_fd, type, num, channel, filter_data, filter_size);
+	voss_set_fir_filter(parent->session->fd(), type, num, channel, filter_data, filter_size);
 	freqres->update();
 }
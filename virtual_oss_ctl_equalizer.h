@@ -107,6 +107,8 @@ public:
 
 	void get_filter();
 
+	static int probe(int, int, int, int);
+
 	int type;
 	int num;
 	int channel;
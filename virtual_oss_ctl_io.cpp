@@ -0,0 +1,390 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_backend.h"
+#include "virtual_oss_ctl_io.h"
+#include "virtual_oss_ctl_session.h"
+
+VOSSIo voss_io;
+
+static const char *voss_io_class[VOSS_IO_MAX] = {
+	"write", "read", "poll"
+};
+
+/* request codes which are profiled by name, the rest is "other" */
+static const struct {
+	unsigned long cmd;
+	const char *name;
+} voss_io_cmd[] = {
+#define	VOSS_IO_CMD(x) { VIRTUAL_OSS_##x, #x }
+	VOSS_IO_CMD(GET_VERSION),
+	VOSS_IO_CMD(GET_SYSTEM_INFO),
+	VOSS_IO_CMD(GET_SAMPLE_RATE),
+	VOSS_IO_CMD(ADD_OPTIONS),
+	VOSS_IO_CMD(GET_RECORDING),
+	VOSS_IO_CMD(SET_RECORDING),
+	VOSS_IO_CMD(GET_DEV_INFO),
+	VOSS_IO_CMD(SET_DEV_INFO),
+	VOSS_IO_CMD(GET_LOOP_INFO),
+	VOSS_IO_CMD(SET_LOOP_INFO),
+	VOSS_IO_CMD(GET_INPUT_MON_INFO),
+	VOSS_IO_CMD(SET_INPUT_MON_INFO),
+	VOSS_IO_CMD(GET_OUTPUT_MON_INFO),
+	VOSS_IO_CMD(SET_OUTPUT_MON_INFO),
+	VOSS_IO_CMD(GET_LOCAL_MON_INFO),
+	VOSS_IO_CMD(SET_LOCAL_MON_INFO),
+	VOSS_IO_CMD(GET_DEV_PEAK),
+	VOSS_IO_CMD(GET_LOOP_PEAK),
+	VOSS_IO_CMD(GET_INPUT_MON_PEAK),
+	VOSS_IO_CMD(GET_OUTPUT_MON_PEAK),
+	VOSS_IO_CMD(GET_LOCAL_MON_PEAK),
+	VOSS_IO_CMD(GET_INPUT_PEAK),
+	VOSS_IO_CMD(GET_OUTPUT_PEAK),
+	VOSS_IO_CMD(GET_DEV_LIMIT),
+	VOSS_IO_CMD(SET_DEV_LIMIT),
+	VOSS_IO_CMD(GET_LOOP_LIMIT),
+	VOSS_IO_CMD(SET_LOOP_LIMIT),
+	VOSS_IO_CMD(GET_OUTPUT_LIMIT),
+	VOSS_IO_CMD(SET_OUTPUT_LIMIT),
+	VOSS_IO_CMD(GET_RX_DEV_FIR_FILTER),
+	VOSS_IO_CMD(SET_RX_DEV_FIR_FILTER),
+	VOSS_IO_CMD(GET_TX_DEV_FIR_FILTER),
+	VOSS_IO_CMD(SET_TX_DEV_FIR_FILTER),
+	VOSS_IO_CMD(GET_RX_LOOP_FIR_FILTER),
+	VOSS_IO_CMD(SET_RX_LOOP_FIR_FILTER),
+	VOSS_IO_CMD(GET_TX_LOOP_FIR_FILTER),
+	VOSS_IO_CMD(SET_TX_LOOP_FIR_FILTER),
+	VOSS_IO_CMD(GET_AUDIO_DELAY_LOCATOR),
+	VOSS_IO_CMD(SET_AUDIO_DELAY_LOCATOR),
+	VOSS_IO_CMD(RST_AUDIO_DELAY_LOCATOR),
+#undef VOSS_IO_CMD
+};
+
+#define	VOSS_IO_CMDS (int)(sizeof(voss_io_cmd) / sizeof(voss_io_cmd[0]))
+
+static int
+voss_io_cmd_index(unsigned long cmd)
+{
+	int x;
+
+	for (x = 0; x != VOSS_IO_CMDS; x++) {
+		if (voss_io_cmd[x].cmd == cmd)
+			break;
+	}
+	return (x);
+}
+
+/* Return the VOSS_IO_FIR_XXX kind of a request code */
+int
+voss_io_fir(unsigned long cmd)
+{
+	switch (cmd) {
+	case VIRTUAL_OSS_GET_RX_DEV_FIR_FILTER:
+	case VIRTUAL_OSS_GET_TX_DEV_FIR_FILTER:
+	case VIRTUAL_OSS_GET_RX_LOOP_FIR_FILTER:
+	case VIRTUAL_OSS_GET_TX_LOOP_FIR_FILTER:
+		return (VOSS_IO_FIR_GET);
+	case VIRTUAL_OSS_SET_RX_DEV_FIR_FILTER:
+	case VIRTUAL_OSS_SET_TX_DEV_FIR_FILTER:
+	case VIRTUAL_OSS_SET_RX_LOOP_FIR_FILTER:
+	case VIRTUAL_OSS_SET_TX_LOOP_FIR_FILTER:
+		return (VOSS_IO_FIR_SET);
+	default:
+		return (VOSS_IO_FIR_NONE);
+	}
+}
+
+/* Sub-bucket of a latency, see VOSS_IO_SUB */
+static int
+voss_io_hdr_bucket(uint64_t usec)
+{
+	int msb;
+	int x;
+
+	if (usec < VOSS_IO_SUB)
+		return (usec);
+
+	for (msb = 0; (usec >> msb) > 1; msb++)
+		;
+
+	x = (msb - 1) * VOSS_IO_SUB + ((usec >> (msb - 2)) & (VOSS_IO_SUB - 1));
+	if (x >= VOSS_IO_HDR_BUCKETS)
+		x = VOSS_IO_HDR_BUCKETS - 1;
+	return (x);
+}
+
+/* Lowest latency of a sub-bucket */
+static uint64_t
+voss_io_hdr_value(int x)
+{
+	if (x < VOSS_IO_SUB)
+		return (x);
+	return ((uint64_t)(VOSS_IO_SUB + x % VOSS_IO_SUB) << (x / VOSS_IO_SUB - 1));
+}
+
+/* Upper bound of the "pml" per mille latency, in microseconds */
+static uint64_t
+voss_io_hdr_percentile(const VOSSIoCmdStats &st, int pml)
+{
+	const uint64_t limit = (st.count * pml + 999) / 1000;
+	uint64_t sum = 0;
+	int x;
+
+	if (st.count == 0)
+		return (0);
+
+	for (x = 0; x != VOSS_IO_HDR_BUCKETS - 1; x++) {
+		sum += st.hist[x];
+		if (sum >= limit)
+			break;
+	}
+	return (voss_io_hdr_value(x + 1));
+}
+
+static VOSSDeviceBackend voss_device_backend;
+
+VOSSIo :: VOSSIo()
+{
+	backend = &voss_device_backend;
+	session = 0;
+	busy = 0;
+	busy_class = 0;
+	memset(ticket_head, 0, sizeof(ticket_head));
+	memset(ticket_tail, 0, sizeof(ticket_tail));
+	memset(stat, 0, sizeof(stat));
+	profile = 0;
+	cmd_stat = 0;
+}
+
+/* Select the backend, before any handle is opened */
+void
+VOSSIo :: setBackend(VOSSBackend *_backend)
+{
+	backend = _backend;
+}
+
+int
+VOSSIo :: open(const char *path)
+{
+	return (backend->open(path));
+}
+
+void
+VOSSIo :: close(int fd)
+{
+	backend->close(fd);
+}
+
+void
+VOSSIo :: setSession(VOSSSession *_session)
+{
+	session = _session;
+}
+
+/* Enable the per request code statistics, before any ioctl is issued */
+void
+VOSSIo :: setProfile(int enable)
+{
+	if (enable == 0 || cmd_stat != 0)
+		return;
+
+	cmd_stat = new VOSSIoCmdStats[VOSS_IO_CMDS + 1];
+	memset(cmd_stat, 0, sizeof(VOSSIoCmdStats) * (VOSS_IO_CMDS + 1));
+	profile = 1;
+}
+
+int
+VOSSIo :: ioctl(int cls, int fd, unsigned long cmd, void *arg)
+{
+	if (session != 0 && fd > -1 && fd == session->fd() && session->isCaller())
+		return (session->ioctl(cls, cmd, arg));
+	return (dispatch(cls, fd, cmd, arg));
+}
+
+int
+VOSSIo :: dispatch(int cls, int fd, unsigned long cmd, void *arg)
+{
+	QThread *self = QThread::currentThread();
+	const uint64_t start = voss_usec();
+	uint64_t ticket;
+	uint64_t issued;
+	uint64_t done;
+	uint64_t usec;
+	int index;
+	int error;
+	int saved;
+	int c;
+
+	lock.lock();
+	ticket = ticket_tail[cls]++;
+	if (++stat[cls].depth > stat[cls].depth_max)
+		stat[cls].depth_max = stat[cls].depth;
+	waiting.append(self);
+
+	for (;;) {
+		if ((busy == 0 || (busy_class == cls && cls == VOSS_IO_READ)) &&
+		    ticket == ticket_head[cls]) {
+			/* higher classes go first */
+			for (c = 0; c != cls; c++) {
+				if (ticket_head[c] != ticket_tail[c])
+					break;
+			}
+			if (c == cls)
+				break;
+		}
+		wakeup.wait(&lock);
+	}
+	ticket_head[cls]++;
+	waiting.removeOne(self);
+
+	if (detached.removeOne(self)) {
+		/* the caller is gone, only give up the turn */
+		stat[cls].depth--;
+		wakeup.wakeAll();
+		lock.unlock();
+		errno = ETIMEDOUT;
+		return (-1);
+	}
+	busy++;
+	busy_class = cls;
+	running.append(self);
+	lock.unlock();
+
+	/* per request code latency excludes the queueing */
+	issued = profile ? voss_usec() : 0;
+	error = backend->ioctl(fd, cmd, arg);
+	saved = errno;
+
+	done = voss_usec();
+	usec = done - issued;
+
+	index = profile ? voss_io_cmd_index(cmd) : 0;
+
+	lock.lock();
+	running.removeOne(self);
+	/* a detached call has already given back its slot */
+	if (!detached.removeOne(self))
+		busy--;
+	stat[cls].depth--;
+	voss_hist_add(stat[cls].latency, done - start);
+	if (profile) {
+		VOSSIoCmdStats &cs = cmd_stat[index];
+
+		cs.hist[voss_io_hdr_bucket(usec)]++;
+		cs.count++;
+		cs.errors += (error != 0);
+		cs.sum_usec += usec;
+		if (usec > cs.max_usec)
+			cs.max_usec = (usec > UINT32_MAX) ? UINT32_MAX : usec;
+	}
+	wakeup.wakeAll();
+	lock.unlock();
+
+	errno = saved;
+	return (error);
+}
+
+/*
+ * Give up on the ioctl of another thread. A running ioctl no longer
+ * holds its slot, and a queued one is dropped when it is its turn.
+ */
+void
+VOSSIo :: detach(QThread *thread)
+{
+	QMutexLocker locker(&lock);
+
+	if (running.contains(thread)) {
+		busy--;
+		detached.append(thread);
+		wakeup.wakeAll();
+	} else if (waiting.contains(thread)) {
+		detached.append(thread);
+	}
+}
+
+void
+VOSSIo :: stats(int cls, VOSSIoStats &result)
+{
+	QMutexLocker locker(&lock);
+
+	result = stat[cls];
+}
+
+void
+VOSSIo :: format(char *buf, size_t size)
+{
+	VOSSIoStats st;
+	size_t len;
+	int cls;
+
+	buf[0] = 0;
+
+	for (cls = 0; cls != VOSS_IO_MAX; cls++) {
+		stats(cls, st);
+
+		len = strlen(buf);
+		snprintf(buf + len, size - len, "%s%s %u/%u/%u us (depth %u)",
+		    cls ? ", " : "ioctl p50/p99/max ", voss_io_class[cls],
+		    voss_hist_percentile(st.latency, 50),
+		    voss_hist_percentile(st.latency, 99),
+		    st.latency.max_usec, st.depth_max);
+	}
+}
+
+/* Write the per request code statistics, if enabled */
+void
+VOSSIo :: dump(FILE *fp)
+{
+	VOSSIoCmdStats st;
+	int x;
+
+	if (profile == 0)
+		return;
+
+	fprintf(fp, "control device ioctls, latency in us:\n"
+	    "%-24s %10s %8s %8s %8s %8s %8s %8s %8s\n", "request",
+	    "count", "errors", "avg", "p50", "p90", "p99", "p99.9", "max");
+
+	for (x = 0; x != VOSS_IO_CMDS + 1; x++) {
+		lock.lock();
+		st = cmd_stat[x];
+		lock.unlock();
+
+		if (st.count == 0)
+			continue;
+
+		fprintf(fp, "%-24s %10llu %8llu %8llu %8llu %8llu %8llu %8llu %8u\n",
+		    (x == VOSS_IO_CMDS) ? "other" : voss_io_cmd[x].name,
+		    (unsigned long long)st.count,
+		    (unsigned long long)st.errors,
+		    (unsigned long long)(st.sum_usec / st.count),
+		    (unsigned long long)voss_io_hdr_percentile(st, 500),
+		    (unsigned long long)voss_io_hdr_percentile(st, 900),
+		    (unsigned long long)voss_io_hdr_percentile(st, 990),
+		    (unsigned long long)voss_io_hdr_percentile(st, 999),
+		    st.max_usec);
+	}
+	fflush(fp);
+}
@@ -0,0 +1,137 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_IO_H_
+#define	_VOSS_CTL_IO_H_
+
+#include "virtual_oss_ctl.h"
+
+/* ioctl priority classes, lower value is served first */
+enum {
+	VOSS_IO_WRITE,		/* user edits */
+	VOSS_IO_READ,		/* configuration reads */
+	VOSS_IO_POLL,		/* meters, gain and background reads */
+	VOSS_IO_MAX,
+};
+
+/* kinds of FIR filter requests, which carry a pointer to the taps */
+enum {
+	VOSS_IO_FIR_NONE,
+	VOSS_IO_FIR_GET,
+	VOSS_IO_FIR_SET,
+};
+
+/*
+ * Per request code histograms have four sub-buckets per power of
+ * two, which keeps the relative error below 25% at all latencies.
+ */
+#define	VOSS_IO_SUB 4
+#define	VOSS_IO_HDR_BUCKETS (VOSS_IO_SUB * 24)
+
+struct VOSSIoCmdStats {
+	uint32_t hist[VOSS_IO_HDR_BUCKETS];
+	uint64_t count;
+	uint64_t errors;
+	uint64_t sum_usec;
+	uint32_t max_usec;
+};
+
+struct VOSSIoStats {
+	VOSSHistogram latency;	/* queueing and running time */
+	uint32_t depth;		/* currently waiting or running */
+	uint32_t depth_max;
+};
+
+/*
+ * All control device ioctls, from any thread, pass through this
+ * scheduler. Only one ioctl is outstanding at any time, except that
+ * configuration reads may overlap each other, so that the threaded
+ * topology discovery keeps its parallelism. When the device is free,
+ * the oldest waiter of the highest priority class runs next.
+ *
+ * Because every meter is polled with its own ioctl, a user edit waits
+ * for at most one poll, regardless of the number of channels. It also
+ * waits for all configuration reads in flight, which is one per
+ * channel type during a discovery.
+ *
+ * The latency from queueing to completion is recorded per class.
+ *
+ * ioctls issued by the GUI thread on the session handle are passed
+ * to the session, which runs them with a timeout on its worker
+ * thread. The worker then queues them here like everybody else.
+ * When the session gives up on a worker, detach() releases the slot
+ * the worker holds, or cancels its queued ioctl, so that a hung
+ * request does not block everybody else.
+ *
+ * The device is accessed through a VOSSBackend, which is the control
+ * device node, the in-process simulator or a trace replay, possibly
+ * wrapped by a trace recorder.
+ *
+ * When enabled by setProfile(), the latency and errors are also
+ * recorded per request code. Disabled, this costs a single branch.
+ */
+class VOSSIo
+{
+public:
+	VOSSIo();
+
+	int open(const char *);
+	void close(int);
+	int ioctl(int, int, unsigned long, void * = 0);
+	int dispatch(int, int, unsigned long, void *);
+	void detach(QThread *);
+
+	void setBackend(VOSSBackend *);
+	void setSession(VOSSSession *);
+	void setProfile(int);
+
+	void stats(int, VOSSIoStats &);
+	void format(char *, size_t);
+	void dump(FILE *);
+
+private:
+	VOSSBackend *backend;
+	VOSSSession *session;
+
+	QMutex lock;
+	QWaitCondition wakeup;
+	int busy;		/* number of running ioctls */
+	int busy_class;
+	QVector<QThread *> waiting;	/* threads queued in dispatch() */
+	QVector<QThread *> running;	/* threads inside the backend */
+	QVector<QThread *> detached;	/* given up by their caller */
+	uint64_t ticket_head[VOSS_IO_MAX];	/* next ticket to serve */
+	uint64_t ticket_tail[VOSS_IO_MAX];	/* next ticket to hand out */
+	VOSSIoStats stat[VOSS_IO_MAX];
+
+	int profile;
+	VOSSIoCmdStats *cmd_stat;	/* indexed like voss_io_cmd[], plus one */
+};
+
+extern VOSSIo voss_io;
+
+int voss_io_fir(unsigned long);
+
+#endif		/* _VOSS_CTL_IO_H_ */
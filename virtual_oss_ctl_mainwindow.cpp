@@ -27,10 +27,27 @@
 #include "virtual_oss_ctl_compressor.h"
 #include "virtual_oss_ctl_equalizer.h"
 #include "virtual_oss_ctl_gridlayout.h"
+#include "virtual_oss_ctl_io.h"
 #include "virtual_oss_ctl_mainwindow.h"
+#include "virtual_oss_ctl_meterbridge.h"
+#include "virtual_oss_ctl_poller.h"
+#include "virtual_oss_ctl_profile.h"
+#include "virtual_oss_ctl_stall.h"
+#include "virtual_oss_ctl_striplist.h"
 
-#define	VBAR_HEIGHT 32
-#define	VBAR_WIDTH 128
+#include <algorithm>
+
+/* colors of the eight level segments, shared with the meter bridge */
+#define	VOSS_BAR_COLOR(n) \
+	QColor(96 + (n) * (VBAR_WIDTH / 8), 192 - (n) * (VBAR_WIDTH / 8), 96)
+
+const QColor voss_bar_colors[8] = {
+	VOSS_BAR_COLOR(0), VOSS_BAR_COLOR(1), VOSS_BAR_COLOR(2),
+	VOSS_BAR_COLOR(3), VOSS_BAR_COLOR(4), VOSS_BAR_COLOR(5),
+	VOSS_BAR_COLOR(6), VOSS_BAR_COLOR(7),
+};
+
+#undef VOSS_BAR_COLOR
 
 VOSSVolumeBar :: VOSSVolumeBar(VOSSController *_parent, int _type, int _channel, int _number)
   : QWidget(_parent)
@@ -40,17 +57,8 @@ VOSSVolumeBar :: VOSSVolumeBar(VOSSController *_parent, int _type, int _channel,
 	channel = _channel;
 	number = _number;
 
-	memset(&io_peak, 0, sizeof(io_peak));
-	io_peak.number = _number;
-	io_peak.channel = _channel;
-
-	memset(&mon_peak, 0, sizeof(mon_peak));
-	mon_peak.number = _number;
-
-	memset(&master_peak, 0, sizeof(master_peak));
-	master_peak.channel = _channel;
-
-	generation = 0;
+	rx_width = -1;
+	tx_width = -1;
 
 	setMinimumSize(VBAR_WIDTH, VBAR_HEIGHT);
 	setMaximumSize(VBAR_WIDTH, VBAR_HEIGHT);
@@ -63,12 +71,13 @@ VOSSVolumeBar :: ~VOSSVolumeBar()
 
 VOSSAudioDelayLocator :: VOSSAudioDelayLocator(VOSSMainWindow *_parent)
 {
-	struct virtual_oss_audio_delay_locator ad;
-	int fd = _parent->dsp_fd;
-	int error;
-
 	parent = _parent;
 
+	memset(&cache, 0, sizeof(cache));
+	cache_valid = 0;
+	cache_after = 0;
+	status_shown[0] = 0;
+
 	gl = new QGridLayout(this);
 
 	setTitle(tr("Audio Delay Locator"));
@@ -85,10 +94,9 @@ VOSSAudioDelayLocator :: VOSSAudioDelayLocator(VOSSMainWindow *_parent)
 	spn_channel_out = new QSpinBox();
 	spn_channel_out->setPrefix(QString("OutCh "));
 
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error == 0) {
-		spn_channel_in->setRange(0, ad.channel_last);
-		spn_channel_out->setRange(0, ad.channel_last);
+	if (fetch() == 0) {
+		spn_channel_in->setRange(0, cache.channel_last);
+		spn_channel_out->setRange(0, cache.channel_last);
 	}
 
 	gl->addWidget(but_enable_disable,0,0,1,1);
@@ -114,130 +122,151 @@ VOSSAudioDelayLocator :: ~VOSSAudioDelayLocator()
 
 }
 
-void
-VOSSAudioDelayLocator :: read_state()
+/* Make sure the cached locator state is valid */
+int
+VOSSAudioDelayLocator :: fetch()
 {
-	struct virtual_oss_audio_delay_locator ad;
-	int fd = parent->dsp_fd;
 	int error;
-	char status[128];
 
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &ad);
+	if (cache_valid)
+		return (0);
+
+	error = voss_io.ioctl(VOSS_IO_READ, parent->session->fd(), VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &cache);
+	cache_valid = (error == 0);
+	return (error);
+}
+
+/* Write the cached locator state through to the device */
+int
+VOSSAudioDelayLocator :: commit()
+{
+	int error;
+
+	error = voss_io.ioctl(VOSS_IO_WRITE, parent->session->fd(), VIRTUAL_OSS_SET_AUDIO_DELAY_LOCATOR, &cache);
+
+	/* only reads started after the write see the new values */
+	cache_after = parent->poller->readSerial() + 1;
+
 	if (error)
+		invalidate();
+	return (error);
+}
+
+/* Forget the cached state, after an error or a reconnect */
+void
+VOSSAudioDelayLocator :: invalidate()
+{
+	cache_valid = 0;
+}
+
+void
+VOSSAudioDelayLocator :: read_state()
+{
+	if (fetch())
 		return;
 
-	spn_channel_in->setValue(ad.channel_input);
-	spn_channel_out->setValue(ad.channel_output);
+	read_state(&cache, 0);
+}
+
+/* Show the state of locator read "serial", 0 for the cached state */
+void
+VOSSAudioDelayLocator :: read_state(const struct virtual_oss_audio_delay_locator *ad, uint64_t serial)
+{
+	char status[128];
+
+	if (serial != 0) {
+		/* this may be a read back from before our own update */
+		if (serial < cache_after)
+			return;
+		cache = *ad;
+		cache_valid = 1;
+	}
+
+	/* setValue() reformats the spin box text even if unchanged */
+	if (spn_channel_in->value() != cache.channel_input)
+		VOSS_DEBUG_REPAINT(VOSS_BLOCKED(spn_channel_in,setValue(cache.channel_input)));
+	if (spn_channel_out->value() != cache.channel_output)
+		VOSS_DEBUG_REPAINT(VOSS_BLOCKED(spn_channel_out,setValue(cache.channel_output)));
 
 	snprintf(status, sizeof(status),
 	    "Delay locator is %s. Output volume level is %d. Measured audio delay is %d samples or %f ms.",
-	    ad.locator_enabled ? "enabled" : "disabled",
-	    (int)ad.signal_output_level,
-	    (int)ad.signal_input_delay,
-	    (float)1000.0 * (float)ad.signal_input_delay / (float)ad.signal_delay_hz);
+	    cache.locator_enabled ? "enabled" : "disabled",
+	    (int)cache.signal_output_level,
+	    (int)cache.signal_input_delay,
+	    (float)1000.0 * (float)cache.signal_input_delay / (float)cache.signal_delay_hz);
+
+	if (strcmp(status, status_shown) == 0)
+		return;
+	strlcpy(status_shown, status, sizeof(status_shown));
 
-	lbl_status->setText(QString(status));
+	VOSS_DEBUG_REPAINT(lbl_status->setText(QString(status)));
 }
 
 void
 VOSSAudioDelayLocator :: handle_reset()
 {
-	int fd = parent->dsp_fd;
-	int error;
+	int fd = parent->session->fd();
 
-	error = ::ioctl(fd, VIRTUAL_OSS_RST_AUDIO_DELAY_LOCATOR);
-	if (error)
-		return;
+	voss_io.ioctl(VOSS_IO_WRITE, fd, VIRTUAL_OSS_RST_AUDIO_DELAY_LOCATOR);
+
+	/* the measured delay is reset by the device */
+	cache_after = parent->poller->readSerial() + 1;
+	invalidate();
 }
 
 void
 VOSSAudioDelayLocator :: handle_signal_up()
 {
-	struct virtual_oss_audio_delay_locator ad;
-	int fd = parent->dsp_fd;
-	int error;
-
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
+	if (fetch())
 		return;
 
-	ad.signal_output_level++;
+	cache.signal_output_level++;
 
-	error = ::ioctl(fd, VIRTUAL_OSS_SET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
-		return;
+	commit();
 }
 
 void
 VOSSAudioDelayLocator :: handle_signal_down()
 {
-	struct virtual_oss_audio_delay_locator ad;
-	int fd = parent->dsp_fd;
-	int error;
-
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
+	if (fetch())
 		return;
 
-	ad.signal_output_level--;
+	cache.signal_output_level--;
 
-	error = ::ioctl(fd, VIRTUAL_OSS_SET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
-		return;
+	commit();
 }
 
 void
 VOSSAudioDelayLocator :: handle_channel_in()
 {
-	struct virtual_oss_audio_delay_locator ad;
-	int fd = parent->dsp_fd;
-	int error;
-
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
+	if (fetch())
 		return;
 
-	ad.channel_input = spn_channel_in->value();
+	cache.channel_input = spn_channel_in->value();
 
-	error = ::ioctl(fd, VIRTUAL_OSS_SET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
-		return;
+	commit();
 }
 
 void
 VOSSAudioDelayLocator :: handle_channel_out()
 {
-	struct virtual_oss_audio_delay_locator ad;
-	int fd = parent->dsp_fd;
-	int error;
-
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
+	if (fetch())
 		return;
 
-	ad.channel_output = spn_channel_out->value();
+	cache.channel_output = spn_channel_out->value();
 
-	error = ::ioctl(fd, VIRTUAL_OSS_SET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
-		return;
+	commit();
 }
 
 void
 VOSSAudioDelayLocator :: handle_enable_disable()
 {
-	struct virtual_oss_audio_delay_locator ad;
-	int fd = parent->dsp_fd;
-	int error;
-
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
+	if (fetch())
 		return;
 
-	ad.locator_enabled = ad.locator_enabled ? 0 : 1;
+	cache.locator_enabled = cache.locator_enabled ? 0 : 1;
 
-	error = ::ioctl(fd, VIRTUAL_OSS_SET_AUDIO_DELAY_LOCATOR, &ad);
-	if (error)
-		return;
+	commit();
 }
 
 VOSSRecordStatus :: VOSSRecordStatus(VOSSMainWindow *_parent)
@@ -293,18 +322,22 @@ VOSSAddOptions :: ~VOSSAddOptions()
 void
 VOSSAddOptions :: handle_add()
 {
-	int fd = parent->dsp_fd;
+	VOSS_STALL_MARK("VOSSAddOptions::handle_add");
+	int fd = parent->session->fd();
 	int error;
 
 	strlcpy(buffer, led_config->text().toLatin1().data(), sizeof(buffer));
 
-	error = ::ioctl(fd, VIRTUAL_OSS_ADD_OPTIONS, buffer);
+	error = voss_io.ioctl(VOSS_IO_WRITE, fd, VIRTUAL_OSS_ADD_OPTIONS, buffer);
 	if (error)
 		return;
 
 	led_config->setText(QString(buffer));
 
 	parent->vsysinfo->updateInfo();
+
+	/* new devices or loopbacks may have been created */
+	parent->handle_hotplug();
 }
 
 
@@ -317,6 +350,19 @@ VOSSSysInfoOptions :: VOSSSysInfoOptions(VOSSMainWindow *_parent)
 	setTitle(tr("System information"));
 
 	gl->addWidget(&lbl_status, 0,0,1,1);
+	gl->addWidget(&lbl_poll, 1,0,1,1);
+	gl->addWidget(&lbl_raster, 2,0,1,1);
+	gl->addWidget(&lbl_startup, 3,0,1,1);
+	gl->addWidget(&lbl_io, 4,0,1,1);
+	gl->addWidget(&lbl_session, 5,0,1,1);
+
+	/* the tick profile overlay is only shown on request */
+	gl->addWidget(&lbl_profile, 6,0,1,1);
+	but_dump = new QPushButton(tr("Dump profile"));
+	gl->addWidget(but_dump, 6,1,1,1);
+	connect(but_dump, SIGNAL(released()), parent, SLOT(handle_dump()));
+	lbl_profile.setVisible(parent->show_profile);
+	but_dump->setVisible(parent->show_profile);
 
 	updateInfo();
 }
@@ -330,10 +376,10 @@ void
 VOSSSysInfoOptions :: updateInfo()
 {
 	struct virtual_oss_system_info info;
-	int fd = parent->dsp_fd;
+	int fd = parent->session->fd();
 	int error;
 
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_SYSTEM_INFO, &info);
+	error = voss_io.ioctl(VOSS_IO_READ, fd, VIRTUAL_OSS_GET_SYSTEM_INFO, &info);
 	if (error)
 		return;
 
@@ -345,14 +391,72 @@ VOSSSysInfoOptions :: updateInfo()
 			   .arg(info.tx_device_name));
 }
 
+void
+VOSSSysInfoOptions :: updatePoll(const VOSSPollSnapshot *ps)
+{
+	char buf[256];
+
+	snprintf(buf, sizeof(buf), "Polled %d channels in %u us, %u ioctls/s avoided, "
+	    "%d strip editors, %u external changes, %u writes, %u coalesced",
+	    (int)ps->peak.size(), (unsigned)ps->sweep_usec,
+	    (unsigned)ps->avoided_rate, parent->gl_ctl->n_editors,
+	    (unsigned)ps->reconcile_changes, (unsigned)parent->n_writes,
+	    (unsigned)parent->n_coalesced);
+
+	lbl_poll.setText(QString(buf));
+
+	voss_io.format(buf, sizeof(buf));
+	lbl_io.setText(QString(buf));
+
+	parent->session->format(buf, sizeof(buf));
+	lbl_session.setText(QString(buf));
+
+	if (parent->show_profile) {
+		char pbuf[512];
+
+		voss_profile.format(pbuf, sizeof(pbuf), parent->vb.size());
+		lbl_profile.setText(QString(pbuf));
+	}
+}
+
+void
+VOSSSysInfoOptions :: updateStartup(uint64_t usec)
+{
+	struct rusage ru;
+	char buf[256];
+
+	if (getrusage(RUSAGE_SELF, &ru) != 0)
+		memset(&ru, 0, sizeof(ru));
+
+	snprintf(buf, sizeof(buf), "Started in %u ms, %ld kB max resident, "
+	    "discovered %d channels in %u us using %u ioctls%s",
+	    (unsigned)(usec / 1000), (long)ru.ru_maxrss,
+	    (int)parent->topology.entries.size(),
+	    (unsigned)parent->topology.discover_usec,
+	    (unsigned)parent->topology.n_ioctls,
+	    parent->topology.cached ? " (cached)" : "");
+
+	lbl_startup.setText(QString(buf));
+}
+
+void
+VOSSSysInfoOptions :: updateRaster(VOSSMeterRaster *raster)
+{
+	char buf[128];
+
+	raster->stats(buf, sizeof(buf));
+
+	lbl_raster.setText(QString(buf));
+}
+
 void
 VOSSRecordStatus :: read_state()
 {
-	int fd = parent->dsp_fd;
+	int fd = parent->session->fd();
 	int value;
 	int error;
 	
-	error = ::ioctl(fd, VIRTUAL_OSS_GET_RECORDING, &value);
+	error = voss_io.ioctl(VOSS_IO_READ, fd, VIRTUAL_OSS_GET_RECORDING, &value);
 	if (error)
 		return;
 
@@ -368,12 +472,12 @@ VOSSRecordStatus :: read_state()
 void
 VOSSRecordStatus :: handle_start()
 {
-	int fd = parent->dsp_fd;
+	int fd = parent->session->fd();
 	int value;
 	int error;
 
 	value = 1;
-	error = ::ioctl(fd, VIRTUAL_OSS_SET_RECORDING, &value);
+	error = voss_io.ioctl(VOSS_IO_WRITE, fd, VIRTUAL_OSS_SET_RECORDING, &value);
 	if (error)
 		return;
 
@@ -383,19 +487,19 @@ VOSSRecordStatus :: handle_start()
 void
 VOSSRecordStatus :: handle_stop()
 {
-	int fd = parent->dsp_fd;
+	int fd = parent->session->fd();
 	int value;
 	int error;
 
 	value = 0;
-	error = ::ioctl(fd, VIRTUAL_OSS_SET_RECORDING, &value);
+	error = voss_io.ioctl(VOSS_IO_WRITE, fd, VIRTUAL_OSS_SET_RECORDING, &value);
 	if (error)
 		return;
 
 	read_state();
 }
 
-static int
+int
 convertPeak(long long x, uint8_t bits)
 {
 	if (bits <= 32)
@@ -417,45 +521,60 @@ VOSSVolumeBar :: drawBar(QPainter &paint, int y, int h, int level)
 	const int d = (VBAR_WIDTH / 8);
 	int x;
 
-	for (x = 0; level > 0; level -= d, x += d) {
-		QColor bar(96 + x, 192 - x, 96);
-		paint.fillRect(x, y, (level >= d) ? d : level, h, bar);
+	for (x = 0; level > 0; level -= d, x += d)
+		paint.fillRect(x, y, (level >= d) ? d : level, h,
+		    voss_bar_colors[x / d]);
+}
+
+void
+VOSSVolumeBar :: refresh(const VOSSPeak *pk)
+{
+	int rx;
+	int tx;
+
+	if (pk == 0 || pk->valid == 0) {
+		rx = tx = -1;
+	} else {
+		rx = convertPeak(pk->rx, pk->bits);
+		tx = convertPeak(pk->tx, pk->bits);
 	}
+
+	/*
+	 * Only schedule a repaint when the quantized bar width
+	 * changes. Qt merges all pending updates into a single
+	 * paint pass for the whole window.
+	 */
+	if (rx == rx_width && tx == tx_width)
+		return;
+
+	rx_width = rx;
+	tx_width = tx;
+
+	VOSS_DEBUG_REPAINT(update());
 }
 
 void
 VOSSVolumeBar :: paintEvent(QPaintEvent *event)
 {
-	int fd = parent->parent->dsp_fd;
-	int doit;
-	int error;
 	int w;
 	int x;
 
+	VOSSProfileScope scope(VOSS_PROF_PAINT);
 	QPainter paint(this);
 
 	QColor black(0,0,0);
 	QColor split(192,192,0);
 
-	doit = (generation != parent->parent->generation);
-	generation = parent->parent->generation;
-
 	switch (type) {
 	case VOSS_TYPE_DEVICE:
 	case VOSS_TYPE_LOOPBACK:
 		paint.fillRect(0,0,VBAR_WIDTH,VBAR_HEIGHT,black);
 
-		if (doit) {
-			error = ::ioctl(fd, (type == VOSS_TYPE_DEVICE) ?
-			    VIRTUAL_OSS_GET_DEV_PEAK : VIRTUAL_OSS_GET_LOOP_PEAK, &io_peak);
-			if (error)
-				break;
-		}
-		w = convertPeak(io_peak.rx_peak_value, io_peak.bits);
-		drawBar(paint, 0, VBAR_HEIGHT / 2, w);
+		if (rx_width < 0)
+			break;
 
-		w = convertPeak(io_peak.tx_peak_value, io_peak.bits);
-		drawBar(paint, VBAR_HEIGHT / 2, VBAR_HEIGHT / 2, w);
+		drawBar(paint, 0, VBAR_HEIGHT / 2, rx_width);
+		drawBar(paint, VBAR_HEIGHT / 2, VBAR_HEIGHT / 2, tx_width);
 
 		for (x = 1; x != 8; x++) {
 			QColor white(192,192,192 - x * 16);
@@ -466,15 +585,16 @@ VOSSVolumeBar :: paintEvent(QPaintEvent *event)
 		break;
 
 	case VOSS_TYPE_INPUT_MON:
+	case VOSS_TYPE_OUTPUT_MON:
+	case VOSS_TYPE_LOCAL_MON:
+	case VOSS_TYPE_MAIN_OUTPUT:
+	case VOSS_TYPE_MAIN_INPUT:
 		paint.fillRect(0,0,VBAR_WIDTH,VBAR_HEIGHT / 2,black);
 
-		if (doit) {
-			error = ::ioctl(fd, VIRTUAL_OSS_GET_INPUT_MON_PEAK, &mon_peak);
-			if (error)
-				break;
-		}
-		w = convertPeak(mon_peak.peak_value, mon_peak.bits);
-		drawBar(paint, 0, VBAR_HEIGHT / 2, w);
+		if (rx_width < 0)
+			break;
+
+		drawBar(paint, 0, VBAR_HEIGHT / 2, rx_width);
 
 		for (x = 1; x != 8; x++) {
 			QColor white(192,192,192 - x * 16);
@@ -483,85 +603,81 @@ VOSSVolumeBar :: paintEvent(QPaintEvent *event)
 		}
 		break;
 
-	case VOSS_TYPE_OUTPUT_MON:
-		paint.fillRect(0,0,VBAR_WIDTH,VBAR_HEIGHT / 2,black);
-
-		if (doit) {
-			error = ::ioctl(fd, VIRTUAL_OSS_GET_OUTPUT_MON_PEAK, &mon_peak);
-			if (error)
-				break;
-		}
-		w = convertPeak(mon_peak.peak_value, mon_peak.bits);
-		drawBar(paint, 0, VBAR_HEIGHT / 2, w);
-
-		for (x = 1; x != 8; x++) {
-			QColor white(192,192,192 - x * 16);
-			w = (x * VBAR_WIDTH) / 8;
-			paint.fillRect(w,0,1,VBAR_HEIGHT / 2,white);
-		}
+	default:
 		break;
+	}
+}
 
-	case VOSS_TYPE_LOCAL_MON:
-		paint.fillRect(0,0,VBAR_WIDTH,VBAR_HEIGHT / 2,black);
+VOSSChannel :: VOSSChannel(int _type, int _channel, int _number, int _slot)
+{
+	type = _type;
+	channel = _channel;
+	number = _number;
+	slot = _slot;
 
-		if (doit) {
-			error = ::ioctl(fd, VIRTUAL_OSS_GET_LOCAL_MON_PEAK, &mon_peak);
-			if (error)
-				break;
-		}
-		w = convertPeak(mon_peak.peak_value, mon_peak.bits);
-		drawBar(paint, 0, VBAR_HEIGHT / 2, w);
+	has_rx_eq = 0;
+	has_tx_eq = 0;
 
-		for (x = 1; x != 8; x++) {
-			QColor white(192,192,192 - x * 16);
-			w = (x * VBAR_WIDTH) / 8;
-			paint.fillRect(w,0,1,VBAR_HEIGHT / 2,white);
-		}
-		break;
+	connect_input_title = 0;
+	connect_output_title = 0;
+	connect_input_label = 0;
+	connect_output_label = 0;
+	connect_row = 0;
 
-	case VOSS_TYPE_MAIN_OUTPUT:
-		paint.fillRect(0,0,VBAR_WIDTH,VBAR_HEIGHT / 2,black);
+	rx_eq = 0;
+	tx_eq = 0;
+	compressor_edit = 0;
 
-		if (doit) {
-			error = ::ioctl(fd, VIRTUAL_OSS_GET_OUTPUT_PEAK, &master_peak);
-			if (error)
-				break;
-		}
-		w = convertPeak(master_peak.peak_value, master_peak.bits);
-		drawBar(paint, 0, VBAR_HEIGHT / 2, w);
+	view = 0;
 
-		for (x = 1; x != 8; x++) {
-			QColor white(192,192,192 - x * 16);
-			w = (x * VBAR_WIDTH) / 8;
-			paint.fillRect(w,0,1,VBAR_HEIGHT / 2,white);
-		}
-		break;
+	info_serial = 0;
+	reconcile_after = 0;
 
-	case VOSS_TYPE_MAIN_INPUT:
-		paint.fillRect(0,0,VBAR_WIDTH,VBAR_HEIGHT / 2,black);
+	dirty = 0;
+	replay = 0;
+}
 
-		if (doit) {
-			error = ::ioctl(fd, VIRTUAL_OSS_GET_INPUT_PEAK, &master_peak);
-			if (error)
-				break;
-		}
-		w = convertPeak(master_peak.peak_value, master_peak.bits);
-		drawBar(paint, 0, VBAR_HEIGHT / 2, w);
+VOSSChannel :: ~VOSSChannel()
+{
+	delete rx_eq;
+	delete tx_eq;
+	delete compressor_edit;
+}
 
-		for (x = 1; x != 8; x++) {
-			QColor white(192,192,192 - x * 16);
-			w = (x * VBAR_WIDTH) / 8;
-			paint.fillRect(w,0,1,VBAR_HEIGHT / 2,white);
-		}
-		break;
+static QString
+voss_channel_title(int type, int number, int channel, const char *desc)
+{
+	char buf[64];
 
-	default:
-		break;
+	if (desc != NULL && desc[0]) {
+		switch (type) {
+		case VOSS_TYPE_DEVICE:
+		case VOSS_TYPE_LOOPBACK:
+		case VOSS_TYPE_MAIN_OUTPUT:
+		case VOSS_TYPE_MAIN_INPUT:
+			snprintf(buf, sizeof(buf),
+			    "%s - Ch%d", desc, channel);
+			break;
+		case VOSS_TYPE_INPUT_MON:
+		case VOSS_TYPE_OUTPUT_MON:
+		case VOSS_TYPE_LOCAL_MON:
+			snprintf(buf, sizeof(buf),
+			    "%s - Ch%d", desc, number);
+			break;
+		default:
+			snprintf(buf, sizeof(buf),
+			    "Channel %d.%d", number, channel);
+			break;
+		}
+	} else {
+		snprintf(buf, sizeof(buf),
+		    "Channel %d.%d", number, channel);
 	}
+	return (QString(buf));
 }
 
-VOSSController :: VOSSController(VOSSMainWindow *_parent, int _type, int _channel, int _number)
-  : connect_input_label(0), connect_output_label(0), connect_row(0)
+VOSSController :: VOSSController(VOSSMainWindow *_parent, int _type)
+  : pc(0)
 {
 	int x;
 
@@ -569,20 +685,11 @@ VOSSController :: VOSSController(VOSSMainWindow *_parent, int _type, int _channe
 
 	parent = _parent;
 	type = _type;
-	channel = _channel;
-	number = _number;
+	channel = 0;
+	number = 0;
+	slot = -1;
 
-	memset(&io_info, 0, sizeof(io_info));
-	io_info.number = _number;
-	io_info.channel = _channel;
-
-	memset(&mon_info, 0, sizeof(mon_info));
-	mon_info.number = _number;
-
-	rx_amp = 0;
-	tx_amp = 0;
-
-	peak_vol = new VOSSVolumeBar(this, _type, _channel, _number);
+	peak_vol = new VOSSVolumeBar(this, _type, 0, 0);
 
 	rx_mute = new QCheckBox();
 
@@ -605,12 +712,6 @@ VOSSController :: VOSSController(VOSSMainWindow *_parent, int _type, int _channe
 	case VOSS_TYPE_LOOPBACK:
 		rx_eq_show = new QPushButton(QString("EQ"));
 		tx_eq_show = new QPushButton(QString("EQ"));
-		rx_eq = new VOSSEqualizer(parent, _type | VOSS_TYPE_RX, number, channel);
-		tx_eq = new VOSSEqualizer(parent, _type | VOSS_TYPE_TX, number, channel);
-		if (rx_eq->filter_size == 0)
-			rx_eq_show->setDisabled(1);
-		if (tx_eq->filter_size == 0)
-			tx_eq_show->setDisabled(1);
 		connect(rx_eq_show, SIGNAL(released()), this, SLOT(handle_rx_eq()));
 		connect(tx_eq_show, SIGNAL(released()), this, SLOT(handle_tx_eq()));
 
@@ -621,8 +722,6 @@ VOSSController :: VOSSController(VOSSMainWindow *_parent, int _type, int _channe
 	default:
 		rx_eq_show = 0;
 		tx_eq_show = 0;
-		rx_eq = 0;
-		tx_eq = 0;
 		spn_rx_dly = 0;
 		break;
 	}
@@ -634,27 +733,15 @@ VOSSController :: VOSSController(VOSSMainWindow *_parent, int _type, int _channe
 	spn_tx_chn->setRange(0, 63);
 	spn_tx_chn->setPrefix(tr("DstCh "));
 
-	get_config();
-
 	switch (type) {
 	case VOSS_TYPE_DEVICE:
 	case VOSS_TYPE_LOOPBACK:
 	case VOSS_TYPE_MAIN_OUTPUT:
 		compressor = new QPushButton(tr("Compressor"));
 		connect(compressor, SIGNAL(released()), this, SLOT(handle_compressor()));
-
-		if (channel == 0) {
-			compressor_edit = new VOSSCompressor(parent,
-			    _type, number, channel,
-			    (_type == VOSS_TYPE_MAIN_OUTPUT) ?
-			    "Main Output" : io_info.name);
-		} else {
-			compressor_edit = 0;
-		}
 		break;
 	default:
 		compressor = 0;
-		compressor_edit = 0;
 		break;
 	}
 
@@ -759,41 +846,49 @@ VOSSController :: VOSSController(VOSSMainWindow *_parent, int _type, int _channe
 
 VOSSController :: ~VOSSController()
 {
-	delete rx_eq;
-	delete tx_eq;
+	unbind();
 }
 
+/*
+ * Attach this editor to a channel record and load its widgets from
+ * the mixer state. Editors are recycled, so every widget which
+ * depends on the channel must be refreshed here.
+ */
 void
-VOSSController :: set_desc(const char *desc)
+VOSSController :: bind(VOSSChannel *_pc)
 {
-	char buf[64];
+	unbind();
 
-	if (desc != NULL && desc[0]) {
-		switch (type) {
-		case VOSS_TYPE_DEVICE:
-		case VOSS_TYPE_LOOPBACK:
-		case VOSS_TYPE_MAIN_OUTPUT:
-		case VOSS_TYPE_MAIN_INPUT:
-			snprintf(buf, sizeof(buf),
-			    "%s - Ch%d", desc, channel);
-			break;
-		case VOSS_TYPE_INPUT_MON:
-		case VOSS_TYPE_OUTPUT_MON:
-		case VOSS_TYPE_LOCAL_MON:
-			snprintf(buf, sizeof(buf),
-			    "%s - Ch%d", desc, number);
-			break;
-		default:
-			snprintf(buf, sizeof(buf),
-			    "Channel %d.%d", number, channel);
-			break;
-		}
-	} else {
-		snprintf(buf, sizeof(buf),
-		    "Channel %d.%d", number, channel);
-	}
+	pc = _pc;
+	pc->view = this;
+
+	channel = pc->channel;
+	number = pc->number;
+	slot = pc->slot;
+
+	peak_vol->channel = channel;
+	peak_vol->number = number;
+	peak_vol->rx_width = -1;
+	peak_vol->tx_width = -1;
+	peak_vol->update();
+
+	if (rx_eq_show != 0)
+		rx_eq_show->setEnabled(pc->has_rx_eq);
+	if (tx_eq_show != 0)
+		tx_eq_show->setEnabled(pc->has_tx_eq);
+
+	setTitle(pc->title);
+	read_state();
+}
 
-	setTitle(QString(buf));
+void
+VOSSController :: unbind(void)
+{
+	if (pc == 0)
+		return;
+	pc->view = 0;
+	pc = 0;
+	slot = -1;
 }
 
 void
@@ -806,7 +901,8 @@ VOSSController :: set_rx_amp(int value)
 	else if (value > 31)
 		value = 31;
 
-	rx_amp = value;
+	if (pc != 0)
+		parent->state.rx_amp[slot] = value;
 
 	snprintf(buf, sizeof(buf), "%d", value);
 
@@ -823,7 +919,8 @@ VOSSController :: set_tx_amp(int value)
 	else if (value > 31)
 		value = 31;
 
-	tx_amp = value;
+	if (pc != 0)
+		parent->state.tx_amp[slot] = value;
 
 	snprintf(buf, sizeof(buf), "%d", value);
 
@@ -833,126 +930,90 @@ VOSSController :: set_tx_amp(int value)
 void
 VOSSController :: handle_set_config(void)
 {
-	int error;
+	VOSS_STALL_MARK("VOSSController::handle_set_config");
+	VOSSMixerState &st = parent->state;
+
+	if (pc == 0)
+		return;
+
+	/* the widgets are the source of truth for user edits */
+	st.rx_mute[slot] = (rx_mute->checkState() == Qt::Checked);
+	st.tx_mute[slot] = (tx_mute->checkState() == Qt::Checked);
+	st.rx_pol[slot] = (rx_polarity->checkState() == Qt::Checked);
+	st.tx_pol[slot] = (tx_polarity->checkState() == Qt::Checked);
+	st.rx_chan[slot] = spn_rx_chn->value();
+	st.tx_chan[slot] = spn_tx_chn->value();
 
 	switch (type) {
 	case VOSS_TYPE_DEVICE:
 	case VOSS_TYPE_LOOPBACK:
-		io_info.rx_mute = (rx_mute->checkState() == Qt::Checked);
-		io_info.tx_mute = (tx_mute->checkState() == Qt::Checked);
-		io_info.rx_pol = (rx_polarity->checkState() == Qt::Checked);
-		io_info.tx_pol = (tx_polarity->checkState() == Qt::Checked);
-		io_info.rx_amp = rx_amp;
-		io_info.tx_amp = tx_amp;
-		io_info.rx_chan = spn_rx_chn->value();
-		io_info.tx_chan = spn_tx_chn->value();
-		io_info.rx_delay = spn_rx_dly->value();
-		error = ::ioctl(parent->dsp_fd, (type == VOSS_TYPE_DEVICE) ?
-		    VIRTUAL_OSS_SET_DEV_INFO : VIRTUAL_OSS_SET_LOOP_INFO, &io_info);
-		break;
-	case VOSS_TYPE_INPUT_MON:
-		mon_info.mute = (rx_mute->checkState() == Qt::Checked);
-		mon_info.pol = (rx_polarity->checkState() == Qt::Checked);
-		mon_info.amp = rx_amp;
-		mon_info.src_chan = spn_rx_chn->value();
-		mon_info.dst_chan = spn_tx_chn->value();
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_SET_INPUT_MON_INFO, &mon_info);
-		break;
-	case VOSS_TYPE_OUTPUT_MON:
-		mon_info.mute = (rx_mute->checkState() == Qt::Checked);
-		mon_info.pol = (rx_polarity->checkState() == Qt::Checked);
-		mon_info.amp = rx_amp;
-		mon_info.src_chan = spn_rx_chn->value();
-		mon_info.dst_chan = spn_tx_chn->value();
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_SET_OUTPUT_MON_INFO, &mon_info);
-		break;
-	case VOSS_TYPE_LOCAL_MON:
-		mon_info.mute = (rx_mute->checkState() == Qt::Checked);
-		mon_info.pol = (rx_polarity->checkState() == Qt::Checked);
-		mon_info.amp = rx_amp;
-		mon_info.src_chan = spn_rx_chn->value();
-		mon_info.dst_chan = spn_tx_chn->value();
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_SET_LOCAL_MON_INFO, &mon_info);
+		/* monitors have no delay */
+		st.rx_delay[slot] = spn_rx_dly->value();
 		break;
 	default:
-		error = EINVAL;
 		break;
 	}
 
-	parent->vconnect->update();
+	parent->queue_write(slot);
 }
 
-void
+int
 VOSSController :: watchdog(void)
 {
-	peak_vol->repaint();
+	/* only meters inside the viewport need polling */
+	if (pc == 0 || parent->visibleRect(peak_vol).isEmpty())
+		return (0);
 
-	if (compressor_edit != 0)
-		compressor_edit->gain_update();
+	peak_vol->refresh(parent->poll_peak(slot));
+	return (VOSS_POLL_PEAK);
 }
 
+/* Refresh the widgets of the given VOSS_FIELD_XXX fields */
 void
-VOSSController :: get_config(void)
+VOSSController :: read_state(int mask)
 {
-	int error;
+	const VOSSMixerState &st = parent->state;
+
+	if (pc == 0)
+		return;
 
 	switch (type) {
 	case VOSS_TYPE_DEVICE:
 	case VOSS_TYPE_LOOPBACK:
-		error = ::ioctl(parent->dsp_fd, (type == VOSS_TYPE_DEVICE) ?
-		    VIRTUAL_OSS_GET_DEV_INFO : VIRTUAL_OSS_GET_LOOP_INFO, &io_info);
-		if (error)
-			break;
-		VOSS_BLOCKED(rx_mute,setCheckState(io_info.rx_mute ? Qt::Checked : Qt::Unchecked));
-		VOSS_BLOCKED(tx_mute,setCheckState(io_info.tx_mute ? Qt::Checked : Qt::Unchecked));
-		VOSS_BLOCKED(rx_polarity,setCheckState(io_info.rx_pol ? Qt::Checked : Qt::Unchecked));
-		VOSS_BLOCKED(tx_polarity,setCheckState(io_info.tx_pol ? Qt::Checked : Qt::Unchecked));
-		set_rx_amp(io_info.rx_amp);
-		set_tx_amp(io_info.tx_amp);
-		VOSS_BLOCKED(spn_rx_chn,setValue(io_info.rx_chan));
-		VOSS_BLOCKED(spn_tx_chn,setValue(io_info.tx_chan));
-		spn_rx_dly->setRange(0, io_info.rx_delay_limit);
-		VOSS_BLOCKED(spn_rx_dly,setValue(io_info.rx_delay));
-		set_desc(io_info.name);
+		if (mask & VOSS_FIELD_RX_MUTE)
+			VOSS_BLOCKED(rx_mute,setCheckState(st.rx_mute[slot] ? Qt::Checked : Qt::Unchecked));
+		if (mask & VOSS_FIELD_TX_MUTE)
+			VOSS_BLOCKED(tx_mute,setCheckState(st.tx_mute[slot] ? Qt::Checked : Qt::Unchecked));
+		if (mask & VOSS_FIELD_RX_POL)
+			VOSS_BLOCKED(rx_polarity,setCheckState(st.rx_pol[slot] ? Qt::Checked : Qt::Unchecked));
+		if (mask & VOSS_FIELD_TX_POL)
+			VOSS_BLOCKED(tx_polarity,setCheckState(st.tx_pol[slot] ? Qt::Checked : Qt::Unchecked));
+		if (mask & VOSS_FIELD_RX_AMP)
+			set_rx_amp(st.rx_amp[slot]);
+		if (mask & VOSS_FIELD_TX_AMP)
+			set_tx_amp(st.tx_amp[slot]);
+		if (mask & VOSS_FIELD_RX_CHAN)
+			VOSS_BLOCKED(spn_rx_chn,setValue(st.rx_chan[slot]));
+		if (mask & VOSS_FIELD_TX_CHAN)
+			VOSS_BLOCKED(spn_tx_chn,setValue(st.tx_chan[slot]));
+		if (mask & VOSS_FIELD_RX_DELAY) {
+			spn_rx_dly->setRange(0, st.rx_delay_limit[slot]);
+			VOSS_BLOCKED(spn_rx_dly,setValue(st.rx_delay[slot]));
+		}
 		break;
 	case VOSS_TYPE_INPUT_MON:
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_INPUT_MON_INFO, &mon_info);
-		if (error)
-			break;
-		rx_mute->setCheckState(mon_info.mute ? Qt::Checked : Qt::Unchecked);
-		rx_polarity->setCheckState(mon_info.pol ? Qt::Checked : Qt::Unchecked);
-		set_rx_amp(mon_info.amp);
-		VOSS_BLOCKED(spn_rx_chn,setValue(mon_info.src_chan));
-		VOSS_BLOCKED(spn_tx_chn,setValue(mon_info.dst_chan));
-		set_desc("Input Monitor");
-		break;
 	case VOSS_TYPE_OUTPUT_MON:
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_OUTPUT_MON_INFO, &mon_info);
-		if (error)
-			break;
-		VOSS_BLOCKED(rx_mute,setCheckState(mon_info.mute ? Qt::Checked : Qt::Unchecked));
-		VOSS_BLOCKED(rx_polarity,setCheckState(mon_info.pol ? Qt::Checked : Qt::Unchecked));
-		set_rx_amp(mon_info.amp);
-		VOSS_BLOCKED(spn_rx_chn,setValue(mon_info.src_chan));
-		VOSS_BLOCKED(spn_tx_chn,setValue(mon_info.dst_chan));
-		set_desc("Output Monitor");
-		break;
 	case VOSS_TYPE_LOCAL_MON:
-		error = ::ioctl(parent->dsp_fd, VIRTUAL_OSS_GET_LOCAL_MON_INFO, &mon_info);
-		if (error)
-			break;
-		rx_mute->setCheckState(mon_info.mute ? Qt::Checked : Qt::Unchecked);
-		rx_polarity->setCheckState(mon_info.pol ? Qt::Checked : Qt::Unchecked);
-		set_rx_amp(mon_info.amp);
-		VOSS_BLOCKED(spn_rx_chn,setValue(mon_info.src_chan));
-		VOSS_BLOCKED(spn_tx_chn,setValue(mon_info.dst_chan));
-		set_desc("Local Monitor");
-		break;
-	case VOSS_TYPE_MAIN_OUTPUT:
-		set_desc("Main Output");
-		break;
-	case VOSS_TYPE_MAIN_INPUT:
-		set_desc("Main Input");
+		if (mask & VOSS_FIELD_RX_MUTE)
+			VOSS_BLOCKED(rx_mute,setCheckState(st.rx_mute[slot] ? Qt::Checked : Qt::Unchecked));
+		if (mask & VOSS_FIELD_RX_POL)
+			VOSS_BLOCKED(rx_polarity,setCheckState(st.rx_pol[slot] ? Qt::Checked : Qt::Unchecked));
+		if (mask & VOSS_FIELD_RX_AMP)
+			set_rx_amp(st.rx_amp[slot]);
+		if (mask & VOSS_FIELD_RX_CHAN)
+			VOSS_BLOCKED(spn_rx_chn,setValue(st.rx_chan[slot]));
+		if (mask & VOSS_FIELD_TX_CHAN)
+			VOSS_BLOCKED(spn_tx_chn,setValue(st.tx_chan[slot]));
 		break;
 	default:
 		break;
@@ -962,221 +1023,1000 @@ VOSSController :: get_config(void)
 void
 VOSSController :: handle_rx_amp_up(void)
 {
-	set_rx_amp(rx_amp + 1);
+	if (pc == 0)
+		return;
+	set_rx_amp(parent->state.rx_amp[slot] + 1);
 	handle_set_config();
 }
 
 void
 VOSSController :: handle_rx_amp_down(void)
 {
-	set_rx_amp(rx_amp - 1);
+	if (pc == 0)
+		return;
+	set_rx_amp(parent->state.rx_amp[slot] - 1);
 	handle_set_config();
 }
 
 void
 VOSSController :: handle_rx_eq(void)
 {
-	rx_eq->show();
+	VOSS_STALL_MARK("VOSSController::handle_rx_eq");
+
+	if (pc == 0)
+		return;
+	if (pc->rx_eq == 0)
+		pc->rx_eq = new VOSSEqualizer(parent, type | VOSS_TYPE_RX, number, channel);
+	pc->rx_eq->show();
 }
 
 void
 VOSSController :: handle_tx_amp_up(void)
 {
-	set_tx_amp(tx_amp + 1);
+	if (pc == 0)
+		return;
+	set_tx_amp(parent->state.tx_amp[slot] + 1);
 	handle_set_config();
 }
 
 void
 VOSSController :: handle_tx_amp_down(void)
 {
-	set_tx_amp(tx_amp - 1);
+	if (pc == 0)
+		return;
+	set_tx_amp(parent->state.tx_amp[slot] - 1);
 	handle_set_config();
 }
 
 void
 VOSSController :: handle_tx_eq(void)
 {
-	tx_eq->show();
+	VOSS_STALL_MARK("VOSSController::handle_tx_eq");
+
+	if (pc == 0)
+		return;
+	if (pc->tx_eq == 0)
+		pc->tx_eq = new VOSSEqualizer(parent, type | VOSS_TYPE_TX, number, channel);
+	pc->tx_eq->show();
 }
 
 void
 VOSSController :: handle_compressor(void)
 {
-	VOSSController **vb = parent->vb;
-	int x;
+	VOSS_STALL_MARK("VOSSController::handle_compressor");
+	VOSSChannel *ch = parent->lookup(type, number, 0);
 
-	for (x = 0; x != MAX_VOLUME_BAR; x++) {
-		if (vb[x] == NULL)
-			continue;
-		if (vb[x]->type == type &&
-		    vb[x]->number == number &&
-		    vb[x]->channel == 0)
-			vb[x]->compressor_edit->show();
+	if (ch == 0)
+		return;
+	if (ch->compressor_edit == 0) {
+		ch->compressor_edit = new VOSSCompressor(parent,
+		    type, number, 0, ch->slot,
+		    (type == VOSS_TYPE_MAIN_OUTPUT) ?
+		    "Main Output" : parent->state.name[ch->slot].c_str());
 	}
+	ch->compressor_edit->show();
 }
 
-VOSSMainWindow :: VOSSMainWindow(const char *dsp)
+VOSSMainWindow :: VOSSMainWindow(const char *dsp, int use_meterbridge, int write_delay,
+    int _show_profile)
 {
-	struct virtual_oss_io_peak io_peak;
-	struct virtual_oss_mon_peak mon_peak;
-	struct virtual_oss_master_peak master_peak;
+	int y;
 
-	int x;
-	int type = 0;
-	int num = 0;
-	int chan = 0;
-	int error;
+	startup.start();
 
-	generation = 0;
+	poller = 0;
+	snapshot = 0;
+	vmeterbridge = 0;
+	vaudiodelay = 0;
+	n_writes = 0;
+	n_coalesced = 0;
+	reconnect_serial = 0;
+	show_profile = _show_profile;
 
 	dsp_name = dsp;
 
-	dsp_fd = ::open(dsp, O_RDWR);
-
-	gl_ctl = new VOSSGridLayout();
+	session = new VOSSSession(dsp);
+	voss_io.setSession(session);
+	connect(session, SIGNAL(reconnected()), this, SLOT(handle_reconnect()));
 
 	eq_copy = 0;
 	compressor_copy = 0;
 
-	for (x = 0; x != MAX_VOLUME_BAR; ) {
-		switch (type) {
-		case VOSS_TYPE_DEVICE:
-			memset(&io_peak, 0, sizeof(io_peak));
-			io_peak.number = num;
-			io_peak.channel = chan;
-			error = ::ioctl(dsp_fd, VIRTUAL_OSS_GET_DEV_PEAK, &io_peak);
-			break;
-		case VOSS_TYPE_LOOPBACK:
-			memset(&io_peak, 0, sizeof(io_peak));
-			io_peak.number = num;
-			io_peak.channel = chan;
-			error = ::ioctl(dsp_fd, VIRTUAL_OSS_GET_LOOP_PEAK, &io_peak);
-			break;
-		case VOSS_TYPE_INPUT_MON:
-			memset(&mon_peak, 0, sizeof(mon_peak));
-			mon_peak.number = num;
-			if (chan != 0) {
-				error = EINVAL;
-				break;
-			}
-			error = ::ioctl(dsp_fd, VIRTUAL_OSS_GET_INPUT_MON_PEAK, &mon_peak);
-			break;
-		case VOSS_TYPE_OUTPUT_MON:
-			memset(&mon_peak, 0, sizeof(mon_peak));
-			mon_peak.number = num;
-			if (chan != 0) {
-				error = EINVAL;
-				break;
-			}
-			error = ::ioctl(dsp_fd, VIRTUAL_OSS_GET_OUTPUT_MON_PEAK, &mon_peak);
-			break;
-		case VOSS_TYPE_LOCAL_MON:
-			memset(&mon_peak, 0, sizeof(mon_peak));
-			mon_peak.number = num;
-			if (chan != 0) {
-				error = EINVAL;
-				break;
-			}
-			error = ::ioctl(dsp_fd, VIRTUAL_OSS_GET_LOCAL_MON_PEAK, &mon_peak);
-			break;
-		case VOSS_TYPE_MAIN_OUTPUT:
-			memset(&master_peak, 0, sizeof(master_peak));
-			master_peak.channel = chan;
-			if (num != 0) {
-				error = EINVAL;
-				break;
-			}
-			error = ::ioctl(dsp_fd, VIRTUAL_OSS_GET_OUTPUT_PEAK, &master_peak);
-			break;
-		case VOSS_TYPE_MAIN_INPUT:
-			memset(&master_peak, 0, sizeof(master_peak));
-			master_peak.channel = chan;
-			if (num != 0) {
-				error = EINVAL;
-				break;
-			}
-			error = ::ioctl(dsp_fd, VIRTUAL_OSS_GET_INPUT_PEAK, &master_peak);
-			break;
-		default:
-			error = EINVAL;
-			break;
-		}
-		if (error) {
-			if (chan == 0) {
-				num = chan = 0;
-				type++;
-				if (type >= VOSS_TYPE_MAX)
-					break;
-			} else {
-				num++;
-				chan = 0;
-			}
-			continue;
-		}
-		vb[x] = new VOSSController(this, type, chan, num);
-		gl_ctl->addWidget(vb[x], x, 0, 1, 1);
-		chan++;
-		x++;
+	/*
+	 * Draw from the cached topology right away, if any, and find
+	 * the live channels in the background. Without a cache, the
+	 * channels appear when the discovery completes.
+	 */
+	topology.load(dsp);
+	discovered = 0;
+	verify_stale = 0;
+	if (session->isUp()) {
+		verify = new VOSSTopologyVerify(dsp);
+		verify->start();
+	} else {
+		verify = 0;
 	}
 
-	for (; x != MAX_VOLUME_BAR; x++)
-		vb[x] = 0;
+	populate();
 
 	vconnect = new VOSSConnect(this);
 	vaudiodelay = new VOSSAudioDelayLocator(this);
 	vrecordstatus = new VOSSRecordStatus(this);
 	vaddoptions = new VOSSAddOptions(this);
 	vsysinfo = new VOSSSysInfoOptions(this);
+	gl_ctl = new VOSSStripList(this);
+
+	meterbridge_mode = use_meterbridge;
+	if (use_meterbridge)
+		vmeterbridge = new VOSSMeterBridge(this, use_meterbridge > 1);
 
 	watchdog = new QTimer(this);
 	connect(watchdog, SIGNAL(timeout()), this, SLOT(handle_watchdog()));
+	connect(verticalScrollBar(), SIGNAL(valueChanged(int)), gl_ctl, SLOT(handle_scroll()));
+
+	hotplug_scan = 0;
+	hotplug_stale = 0;
+	hotplug = new QTimer(this);
+	connect(hotplug, SIGNAL(timeout()), this, SLOT(handle_hotplug()));
+
+	stats = new QTimer(this);
+	connect(stats, SIGNAL(timeout()), this, SLOT(handle_stats()));
+
+	heartbeat = new QTimer(this);
+	connect(heartbeat, SIGNAL(timeout()), this, SLOT(handle_heartbeat()));
+
+	flush = new QTimer(this);
+	flush->setSingleShot(true);
+	flush->setInterval(write_delay);
+	connect(flush, SIGNAL(timeout()), this, SLOT(handle_flush()));
 
 	gl_main = new VOSSGridLayout();
-	gl_main->addWidget(vconnect,0,0,1,1);
-	gl_main->addWidget(gl_ctl,1,0,1,1);
-	gl_main->addWidget(vaudiodelay,2,0,1,1);
-	gl_main->addWidget(vrecordstatus,3,0,1,1);
-	gl_main->addWidget(vaddoptions,4,0,1,1);
-	gl_main->addWidget(vsysinfo,5,0,1,1);
+	y = 0;
+	if (vmeterbridge != 0)
+		gl_main->addWidget(vmeterbridge,y++,0,1,1);
+	gl_main->addWidget(vconnect,y++,0,1,1);
+	gl_main->addWidget(gl_ctl,y++,0,1,1);
+	gl_main->addWidget(vaudiodelay,y++,0,1,1);
+	gl_main->addWidget(vrecordstatus,y++,0,1,1);
+	gl_main->addWidget(vaddoptions,y++,0,1,1);
+	gl_main->addWidget(vsysinfo,y++,0,1,1);
 
 	setWindowTitle(QString("Virtual OSS Control"));
 	setWindowIcon(QIcon(QString(":/virtual_oss_ctl.png")));
 	setWidget(gl_main);
 
-	watchdog->start(100);
+	poller->start();
+	watchdog->start(VOSS_POLL_FAST);
+	hotplug->start(VOSS_HOTPLUG_INTERVAL);
+	stats->start(VOSS_STATS_INTERVAL);
+	if (voss_stall != 0)
+		heartbeat->start(voss_stall->period());
+
+	startup_usec = startup.nsecsElapsed() / 1000;
+	vsysinfo->updateStartup(startup_usec);
+}
+
+/*
+ * Create the channel records, the mixer state and the poller from
+ * the current topology.
+ */
+void
+VOSSMainWindow :: populate(void)
+{
+	int x;
+
+	/* drop the slots of channels removed by hot-plugging */
+	for (x = 0; x != topology.entries.size(); ) {
+		if (topology.entries[x].type < 0)
+			topology.entries.remove(x);
+		else
+			x++;
+	}
+
+	for (x = 0; x != topology.entries.size(); x++)
+		add_channel(topology.entries[x]);
+
+	make_poller();
+}
+
+void
+VOSSMainWindow :: make_poller(void)
+{
+	QVector<VOSSPollEntry> table;
+	int x;
+
+	for (x = 0; x != vb.size(); x++) {
+		VOSSPollEntry pe;
+
+		pe.type = vb[x]->type;
+		pe.number = vb[x]->number;
+		pe.channel = vb[x]->channel;
+		pe.limit = (vb[x]->channel == 0 &&
+		    (pe.type == VOSS_TYPE_DEVICE ||
+		     pe.type == VOSS_TYPE_LOOPBACK ||
+		     pe.type == VOSS_TYPE_MAIN_OUTPUT));
+
+		table.append(pe);
+
+		/* the serial numbers start over with every poller */
+		vb[x]->info_serial = 0;
+		vb[x]->reconcile_after = 0;
+	}
+	if (vaudiodelay != 0)
+		vaudiodelay->cache_after = 0;
+	reconnect_serial = 0;
+
+	poller = new VOSSPoller(dsp_name, table, 100);
+}
+
+/* Create the record and mixer state of a new channel */
+VOSSChannel *
+VOSSMainWindow :: add_channel(const VOSSTopologyEntry &e)
+{
+	const int x = vb.size();
+
+	state.add(e.type, e.number, e.channel);
+	vb.append(new VOSSChannel(e.type, e.channel, e.number, x));
+	vb_index.insert(key(e.type, e.number, e.channel), vb[x]);
+	load_config(x, e);
+
+	return (vb[x]);
+}
+
+/*
+ * Tear down a channel which no longer exists. The slot is kept as a
+ * tombstone, so that the slots of all other channels stay valid.
+ */
+void
+VOSSMainWindow :: remove_channel(int x)
+{
+	VOSSChannel *ch = vb[x];
+
+	gl_ctl->release_channel(ch);
+	vconnect->remove(ch);
+	vb_index.remove(key(ch->type, ch->number, ch->channel));
+
+	delete ch->rx_eq;
+	delete ch->tx_eq;
+	delete ch->compressor_edit;
+	ch->rx_eq = 0;
+	ch->tx_eq = 0;
+	ch->compressor_edit = 0;
+
+	ch->type = -1;
+	ch->title = QString();
+	state.type[x] = -1;
+	topology.entries[x].type = -1;
+}
+
+/*
+ * Start looking for channels which were added or removed since the
+ * last discovery, see VOSSTopologyHotplug. This is run periodically
+ * and after options were added. The result is picked up by the
+ * watchdog.
+ */
+void
+VOSSMainWindow :: handle_hotplug(void)
+{
+	VOSS_STALL_MARK("VOSSMainWindow::handle_hotplug");
+	QVector<VOSSTopologyEntry> known;
+	VOSSTopologyEntry e;
+	int x;
+
+	/* wait for the background discovery */
+	if (verify != 0 || hotplug_scan != 0 || !session->isUp())
+		return;
+
+	/* a failed or stale discovery is retried from here */
+	if (discovered == 0) {
+		verify = new VOSSTopologyVerify(dsp_name);
+		verify->start();
+		return;
+	}
+
+	memset(&e, 0, sizeof(e));
+	for (x = 0; x != vb.size(); x++) {
+		if (vb[x]->type < 0)
+			continue;
+		e.type = vb[x]->type;
+		e.number = vb[x]->number;
+		e.channel = vb[x]->channel;
+		known.append(e);
+	}
+
+	hotplug_scan = new VOSSTopologyHotplug(dsp_name, known);
+	hotplug_scan->start();
+}
+
+/* Add and remove the channels found by the hot-plug scan */
+void
+VOSSMainWindow :: apply_hotplug(void)
+{
+	VOSS_STALL_MARK("VOSSMainWindow::apply_hotplug");
+	const VOSSTopologyHotplug *hs = hotplug_scan;
+	QVector<VOSSChannel *> added;
+	VOSSChannel *ch;
+	int type;
+	int x;
+
+	/* the result is of no use after a failure or a reconnect */
+	if (hs->failed || hotplug_stale ||
+	    (hs->added.isEmpty() && hs->removed.isEmpty())) {
+		delete hotplug_scan;
+		hotplug_scan = 0;
+		hotplug_stale = 0;
+		return;
+	}
+
+	handle_flush();
+
+	for (x = 0; x != hs->removed.size(); x++) {
+		const VOSSTopologyEntry &e = hs->removed[x];
+
+		ch = lookup(e.type, e.number, e.channel);
+		if (ch != 0)
+			remove_channel(ch->slot);
+	}
+
+	for (x = 0; x != hs->added.size(); x++) {
+		const VOSSTopologyEntry &e = hs->added[x];
+
+		if (lookup(e.type, e.number, e.channel) != 0)
+			continue;
+		added.append(add_channel(e));
+		topology.entries.append(e);
+	}
+
+	delete hotplug_scan;
+	hotplug_scan = 0;
+
+	for (type = 0; type != VOSS_TYPE_MAX; type++)
+		topology.count[type] = 0;
+	for (x = 0; x != topology.entries.size(); x++) {
+		if (topology.entries[x].type >= 0)
+			topology.count[topology.entries[x].type]++;
+	}
+	topology.save(dsp_name);
+
+	/* the poller has a fixed table, give it a new one */
+	delete poller;
+	snapshot = 0;
+	make_poller();
+	poller->start();
+
+	gl_ctl->relayout();
+	gl_ctl->sync();
+
+	for (x = 0; x != added.size(); x++)
+		vconnect->insert(added[x]);
+	vconnect->relayout();
+
+	if (vmeterbridge != 0) {
+		QWidget *old = vmeterbridge;
+
+		vmeterbridge = new VOSSMeterBridge(this, meterbridge_mode > 1);
+		gl_main->replaceWidget(old, vmeterbridge);
+		delete old;
+	}
+}
+
+/*
+ * Throw away all channels and build them again from the current
+ * topology. This is used when the channel layout has changed.
+ */
+void
+VOSSMainWindow :: rebuild(void)
+{
+	VOSS_STALL_MARK("VOSSMainWindow::rebuild");
+	QWidget *old;
+
+	handle_flush();
+
+	delete poller;
+	poller = 0;
+	snapshot = 0;
+
+	gl_ctl->reset();
+
+	qDeleteAll(vb);
+	vb.clear();
+	vb_index.clear();
+	state.clear();
+
+	populate();
+
+	gl_ctl->relayout();
+
+	old = vconnect;
+	vconnect = new VOSSConnect(this);
+	gl_main->replaceWidget(old, vconnect);
+	delete old;
+
+	if (vmeterbridge != 0) {
+		old = vmeterbridge;
+		vmeterbridge = new VOSSMeterBridge(this, meterbridge_mode > 1);
+		gl_main->replaceWidget(old, vmeterbridge);
+		delete old;
+	}
+
+	poller->start();
+}
+
+/*
+ * Compare the topology loaded from the cache with the result of the
+ * background discovery. Only channels whose configuration differs
+ * are reloaded, unless the channel layout itself has changed.
+ */
+void
+VOSSMainWindow :: verify_topology(void)
+{
+	VOSS_STALL_MARK("VOSSMainWindow::verify_topology");
+	const VOSSTopology &live = verify->result;
+	int x;
+
+	/* the result is of no use after a failure or a reconnect */
+	if (verify->failed || verify_stale) {
+		delete verify;
+		verify = 0;
+		verify_stale = 0;
+		return;
+	}
+
+	if (topology.same_layout(live)) {
+		for (x = 0; x != live.entries.size(); x++) {
+			/* a queued local change wins, like in reconcile() */
+			if (vb[x]->dirty != 0 || (vb[x]->replay & VOSS_REPLAY_INFO))
+				continue;
+			if (memcmp(&topology.entries[x], &live.entries[x],
+			    sizeof(VOSSTopologyEntry)) != 0)
+				load_config(x, live.entries[x]);
+		}
+		topology = live;
+		vconnect->update();
+	} else {
+		topology = live;
+		rebuild();
+	}
+
+	topology.save(dsp_name);
+	discovered = 1;
+
+	delete verify;
+	verify = 0;
+
+	vsysinfo->updateStartup(startup_usec);
 }
 
 VOSSMainWindow :: ~VOSSMainWindow()
 {
+	/* the last value must always be written */
+	handle_flush();
+
+	/* don't hang on exit because of a stalled device */
+	if (verify != 0 && verify->wait(VOSS_SESSION_TIMEOUT))
+		delete verify;
+	if (hotplug_scan != 0 && hotplug_scan->wait(VOSS_SESSION_TIMEOUT))
+		delete hotplug_scan;
+	delete poller;
+	delete gl_ctl;
+	qDeleteAll(vb);
+
+	voss_io.setSession(0);
+	delete session;
+}
 
+VOSSChannel *
+VOSSMainWindow :: lookup(int type, int number, int channel) const
+{
+	return (vb_index.value(key(type, number, channel), 0));
 }
 
+/* Orders channel slots the same way the topology is enumerated */
+class VOSSSlotOrder
+{
+public:
+	VOSSSlotOrder(const VOSSMainWindow *_parent) : parent(_parent) {};
+
+	bool operator()(int a, int b) const {
+		const VOSSChannel *pa = parent->vb[a];
+		const VOSSChannel *pb = parent->vb[b];
+
+		return (VOSSMainWindow::key(pa->type, pa->number, pa->channel) <
+		    VOSSMainWindow::key(pb->type, pb->number, pb->channel));
+	};
+
+	const VOSSMainWindow *parent;
+};
+
+/*
+ * Get the slots of all existing channels in topology order. Channels
+ * added by hot-plugging have their slots at the end.
+ */
 void
-VOSSMainWindow :: handle_watchdog(void)
+VOSSMainWindow :: slot_order(QVector<int> &order) const
 {
 	int x;
-	int error;
 
-	if (dsp_fd < 0)
-		dsp_fd = ::open(dsp_name, O_RDWR);
+	order.clear();
+	for (x = 0; x != vb.size(); x++) {
+		if (vb[x]->type >= 0)
+			order.append(x);
+	}
+	std::sort(order.begin(), order.end(), VOSSSlotOrder(this));
+}
+
+/*
+ * Re-read the configuration of a single channel. This does not need
+ * an editor widget.
+ */
+void
+VOSSMainWindow :: get_config(int x)
+{
+	VOSSTopologyEntry e;
+	uint32_t n = 0;
+
+	memset(&e, 0, sizeof(e));
+	e.type = vb[x]->type;
+	e.number = vb[x]->number;
+	e.channel = vb[x]->channel;
+
+	if (VOSSTopology::probe(session->fd(), e, n) == 0)
+		load_config(x, e);
+}
 
-	if (dsp_fd < 0)
+/*
+ * Store a probed channel configuration in the mixer state and
+ * refresh the channel record and its editor, if any.
+ */
+void
+VOSSMainWindow :: load_config(int x, const VOSSTopologyEntry &e)
+{
+	VOSSChannel *ch = vb[x];
+	const char *desc = 0;
+
+	switch (ch->type) {
+	case VOSS_TYPE_DEVICE:
+	case VOSS_TYPE_LOOPBACK:
+		state.set_io_info(x, &e.io_info);
+		desc = state.name[x].c_str();
+		ch->has_rx_eq = (e.rx_eq_size != 0);
+		ch->has_tx_eq = (e.tx_eq_size != 0);
+		break;
+	case VOSS_TYPE_INPUT_MON:
+		state.set_mon_info(x, &e.mon_info);
+		desc = "Input Monitor";
+		break;
+	case VOSS_TYPE_OUTPUT_MON:
+		state.set_mon_info(x, &e.mon_info);
+		desc = "Output Monitor";
+		break;
+	case VOSS_TYPE_LOCAL_MON:
+		state.set_mon_info(x, &e.mon_info);
+		desc = "Local Monitor";
+		break;
+	case VOSS_TYPE_MAIN_OUTPUT:
+		desc = "Main Output";
+		break;
+	case VOSS_TYPE_MAIN_INPUT:
+		desc = "Main Input";
+		break;
+	default:
+		break;
+	}
+
+	ch->title = voss_channel_title(ch->type, ch->number, ch->channel, desc);
+
+	if (ch->view != 0)
+		ch->view->bind(ch);
+}
+
+/*
+ * Apply a configuration which was changed by another client. Only
+ * the fields which differ from the mixer state are refreshed.
+ */
+void
+VOSSMainWindow :: reconcile(int x, const VOSSPollSlot &sl)
+{
+	VOSSChannel *ch = vb[x];
+	int mask;
+
+	/*
+	 * A queued local change wins, and so does a read back from
+	 * before it. The change is then left for a later snapshot,
+	 * which carries the most recent read back of the slot.
+	 */
+	if (ch->dirty != 0 || (ch->replay & VOSS_REPLAY_INFO) ||
+	    sl.info_read < ch->reconcile_after)
 		return;
 
-	error = ::ioctl(dsp_fd, VIRTUAL_OSS_GET_VERSION, &x);
-	if (error != 0) {
-		::close(dsp_fd);
-		dsp_fd = -1;
+	ch->info_serial = sl.info_serial;
+
+	switch (ch->type) {
+	case VOSS_TYPE_DEVICE:
+	case VOSS_TYPE_LOOPBACK:
+		mask = state.io_info_diff(x, &sl.io_info);
+		if (mask != 0)
+			state.set_io_info(x, &sl.io_info);
+		break;
+	case VOSS_TYPE_INPUT_MON:
+	case VOSS_TYPE_OUTPUT_MON:
+	case VOSS_TYPE_LOCAL_MON:
+		mask = state.mon_info_diff(x, &sl.mon_info);
+		if (mask != 0)
+			state.set_mon_info(x, &sl.mon_info);
+		break;
+	default:
+		return;
+	}
+
+	if (mask == 0)
+		return;
+	if (ch->view != 0)
+		VOSS_DEBUG_REPAINT(ch->view->read_state(mask));
+	if (mask & VOSS_FIELD_ROUTING)
+		VOSS_DEBUG_REPAINT(vconnect->update());
+}
+
+/*
+ * Queue the configuration of a slot for writing. Changes to a slot
+ * which is already queued are merged, because the mixer state always
+ * holds the latest value. The queue is flushed once per deadline,
+ * which starts with the first queued change.
+ */
+void
+VOSSMainWindow :: queue_write(int x)
+{
+	if (vb[x]->dirty != 0) {
+		n_coalesced++;
+		return;
+	}
+	vb[x]->dirty = 1;
+	pending.append(x);
+
+	if (!flush->isActive())
+		flush->start();
+}
+
+void
+VOSSMainWindow :: handle_flush(void)
+{
+	VOSS_STALL_MARK("VOSSMainWindow::handle_flush");
+	int x;
+
+	if (pending.isEmpty())
 		return;
+
+	flush->stop();
+
+	for (x = 0; x != pending.size(); x++) {
+		VOSSChannel *ch = vb[pending[x]];
+
+		ch->dirty = 0;
+		if (ch->type < 0)
+			continue;
+		if (write_config(pending[x]) != 0)
+			ch->replay |= VOSS_REPLAY_INFO;
+		n_writes++;
+	}
+	pending.clear();
+
+	vconnect->update();
+}
+
+/* Write the configuration of a slot from the mixer state */
+int
+VOSSMainWindow :: write_config(int x)
+{
+	struct virtual_oss_io_info io_info;
+	struct virtual_oss_mon_info mon_info;
+	int error;
+
+	switch (vb[x]->type) {
+	case VOSS_TYPE_DEVICE:
+	case VOSS_TYPE_LOOPBACK:
+		state.get_io_info(x, &io_info);
+		error = voss_io.ioctl(VOSS_IO_WRITE, session->fd(), (vb[x]->type == VOSS_TYPE_DEVICE) ?
+		    VIRTUAL_OSS_SET_DEV_INFO : VIRTUAL_OSS_SET_LOOP_INFO, &io_info);
+		break;
+	case VOSS_TYPE_INPUT_MON:
+		state.get_mon_info(x, &mon_info);
+		error = voss_io.ioctl(VOSS_IO_WRITE, session->fd(), VIRTUAL_OSS_SET_INPUT_MON_INFO, &mon_info);
+		break;
+	case VOSS_TYPE_OUTPUT_MON:
+		state.get_mon_info(x, &mon_info);
+		error = voss_io.ioctl(VOSS_IO_WRITE, session->fd(), VIRTUAL_OSS_SET_OUTPUT_MON_INFO, &mon_info);
+		break;
+	case VOSS_TYPE_LOCAL_MON:
+		state.get_mon_info(x, &mon_info);
+		error = voss_io.ioctl(VOSS_IO_WRITE, session->fd(), VIRTUAL_OSS_SET_LOCAL_MON_INFO, &mon_info);
+		break;
+	default:
+		error = EINVAL;
+		break;
+	}
+
+	/* only reads started after the write see the new values */
+	vb[x]->reconcile_after = poller->readSerial() + 1;
+
+	return (error);
+}
+
+/* Write the compressor settings of a slot from the mixer state */
+int
+VOSSMainWindow :: write_limit(int x)
+{
+	struct virtual_oss_compressor limit;
+	struct virtual_oss_io_limit io_limit;
+	int error;
+
+	state.get_limit(x, &limit);
+
+	switch (vb[x]->type) {
+	case VOSS_TYPE_MAIN_OUTPUT:
+		error = voss_io.ioctl(VOSS_IO_WRITE, session->fd(), VIRTUAL_OSS_SET_OUTPUT_LIMIT, &limit);
+		break;
+	case VOSS_TYPE_DEVICE:
+		memset(&io_limit, 0, sizeof(io_limit));
+		io_limit.number = vb[x]->number;
+		io_limit.param = limit;
+		error = voss_io.ioctl(VOSS_IO_WRITE, session->fd(), VIRTUAL_OSS_SET_DEV_LIMIT, &io_limit);
+		break;
+	case VOSS_TYPE_LOOPBACK:
+		memset(&io_limit, 0, sizeof(io_limit));
+		io_limit.number = vb[x]->number;
+		io_limit.param = limit;
+		error = voss_io.ioctl(VOSS_IO_WRITE, session->fd(), VIRTUAL_OSS_SET_LOOP_LIMIT, &io_limit);
+		break;
+	default:
+		error = EINVAL;
+		break;
+	}
+
+	/* the device state is unknown, keep ours for the replay */
+	if (error != 0) {
+		state.limit_valid[x] = 0;
+		vb[x]->replay |= VOSS_REPLAY_LIMIT;
 	}
+	return (error);
+}
+
+/*
+ * The control device is back. Drop what was cached from before,
+ * start checking for channel changes and then write everything the
+ * user changed while the device was away, in one pass.
+ */
+void
+VOSSMainWindow :: handle_reconnect(void)
+{
+	VOSS_STALL_MARK("VOSSMainWindow::handle_reconnect");
+	QElapsedTimer elapsed;
+	int n = 0;
+	int x;
+
+	elapsed.start();
 
-	generation ++;
+	vaudiodelay->invalidate();
+	state.invalidate_limits();
 
-	for (x = 0; x != MAX_VOLUME_BAR; x++) {
-		if (vb[x] == NULL)
+	/* a scan which is still running may have seen the old device */
+	if (verify != 0)
+		verify_stale = 1;
+	if (hotplug_scan != 0)
+		hotplug_stale = 1;
+	handle_hotplug();
+	handle_flush();
+
+	reconnect_serial = poller->published() + 1;
+
+	for (x = 0; x != vb.size() && session->isUp(); x++) {
+		VOSSChannel *ch = vb[x];
+		const int replay = ch->replay;
+
+		if (replay == 0)
 			continue;
-		vb[x]->watchdog();
+		ch->replay = 0;
+		if (ch->type < 0)
+			continue;
+		if ((replay & VOSS_REPLAY_INFO) && write_config(x) != 0)
+			ch->replay |= VOSS_REPLAY_INFO;
+		if ((replay & VOSS_REPLAY_LIMIT) && write_limit(x) != 0)
+			ch->replay |= VOSS_REPLAY_LIMIT;
+		n++;
+	}
+
+	vconnect->update();
+	vsysinfo->updateInfo();
+
+	warnx("replayed %d channels in %u ms", n, (unsigned)elapsed.elapsed());
+}
+
+const VOSSPollSlot *
+VOSSMainWindow :: poll_slot(int x) const
+{
+	if (snapshot == 0 || x < 0 || x >= snapshot->slot.size())
+		return (0);
+	return (&snapshot->slot[x]);
+}
+
+const VOSSPeak *
+VOSSMainWindow :: poll_peak(int x) const
+{
+	if (snapshot == 0 || x < 0 || x >= snapshot->peak.size())
+		return (0);
+	return (&snapshot->peak[x]);
+}
+
+int
+VOSSMainWindow :: poll_wanted(int x)
+{
+	VOSSChannel *ch = vb[x];
+	const VOSSPollSlot *sl;
+	int flags = 0;
+
+	if (ch->view != 0)
+		flags |= ch->view->watchdog();
+
+	if (ch->compressor_edit != 0 && ch->compressor_edit->isVisible()) {
+		sl = poll_slot(x);
+		if (sl != 0 && sl->limit_valid)
+			ch->compressor_edit->gain_update(&sl->limit);
+		flags |= VOSS_POLL_LIMIT;
+	}
+	return (flags);
+}
+
+void
+VOSSMainWindow :: handle_watchdog(void)
+{
+	VOSS_STALL_MARK("VOSSMainWindow::handle_watchdog");
+	const VOSSPollSnapshot *ps;
+	int x;
+#ifdef VOSS_DEBUG_ALLOC
+	const uint64_t allocated = voss_alloc_bytes();
+	const uint64_t repainted = voss_repaint_bytes;
+#endif
+
+	poller->setPaused(isMinimized());
+
+	if (isMinimized())
+		return;
+
+	/* a tick which returns early is not profiled */
+	voss_profile.begin();
+
+	ps = poller->consume();
+	if (ps == 0)
+		return;
+
+	snapshot = ps;
+
+	if (ps->online == 0) {
+		/* skip snapshots from before the last reconnect */
+		if (ps->serial > reconnect_serial)
+			session->fail();
+		return;
+	}
+
+	if (verify != 0 && verify->isFinished()) {
+		verify_topology();
+		return;
+	}
+
+	if (hotplug_scan != 0 && hotplug_scan->isFinished()) {
+		apply_hotplug();
+		return;
+	}
+
+	voss_profile.mark(VOSS_PROF_CONSUME);
+
+	/* mirror the polled values into the mixer state */
+	for (x = 0; x != ps->slot.size() && x != (int)state.size(); x++) {
+		if (ps->slot[x].limit_valid) {
+			/* refill an invalidated cache, else track the gain only */
+			if (state.limit_valid[x] == 0 &&
+			    (vb[x]->replay & VOSS_REPLAY_LIMIT) == 0)
+				state.set_limit(x, &ps->slot[x].limit);
+			else
+				state.limit_gain[x] = ps->slot[x].limit.gain;
+		}
+		if (ps->slot[x].info_serial != vb[x]->info_serial)
+			reconcile(x, ps->slot[x]);
 	}
 
-	vaudiodelay->read_state();
+	voss_profile.mark(VOSS_PROF_MIRROR);
+
+	/* bind editors to the rows which scrolled into view */
+	VOSS_DEBUG_REPAINT(gl_ctl->sync());
+
+	voss_profile.mark(VOSS_PROF_BIND);
+
+	if (vmeterbridge != 0) {
+		const QRect region = visibleRect(vmeterbridge);
+
+		for (x = 0; x != vb.size(); x++) {
+			if (vmeterbridge->rowVisible(region, x)) {
+				vmeterbridge->refresh(x, poll_peak(x));
+				poller->setWanted(x, poll_wanted(x) | VOSS_POLL_PEAK);
+			} else {
+				poller->setWanted(x, poll_wanted(x));
+			}
+		}
+		vmeterbridge->flush();
+	} else {
+		for (x = 0; x != vb.size(); x++)
+			poller->setWanted(x, poll_wanted(x));
+	}
+
+	voss_profile.mark(VOSS_PROF_METERS);
+
+	if (visibleRect(vaudiodelay).isEmpty()) {
+		poller->setWantedLocator(0);
+	} else {
+		poller->setWantedLocator(1);
+		if (ps->locator_valid)
+			vaudiodelay->read_state(&ps->locator, ps->locator_serial);
+	}
+
+	voss_profile.mark(VOSS_PROF_LOCATOR);
+	voss_profile.end();
+
+#ifdef VOSS_DEBUG_ALLOC
+	/*
+	 * Only the Qt calls which request a repaint may allocate.
+	 * Skip the first ticks, which size the buffers.
+	 */
+	if (ps->serial > VOSS_ALLOC_WARMUP &&
+	    voss_alloc_bytes() - allocated != voss_repaint_bytes - repainted) {
+		errx(EX_SOFTWARE, "watchdog tick allocated %llu bytes",
+		    (unsigned long long)((voss_alloc_bytes() - allocated) -
+		    (voss_repaint_bytes - repainted)));
+	}
+#endif
+}
+
+void
+VOSSMainWindow :: handle_dump(void)
+{
+	voss_profile.dump(stderr, vb.size());
+	voss_io.dump(stderr);
+	if (voss_stall != 0)
+		voss_stall->dump(stderr);
+}
+
+/* Tell the stall detector that the event loop is alive */
+void
+VOSSMainWindow :: handle_heartbeat(void)
+{
+	voss_stall->beat();
+}
+
+/* Refresh the statistics, which is not part of the watchdog tick */
+void
+VOSSMainWindow :: handle_stats(void)
+{
+	VOSS_STALL_MARK("VOSSMainWindow::handle_stats");
+
+	if (snapshot == 0 || isMinimized() || visibleRect(vsysinfo).isEmpty())
+		return;
+
+	vsysinfo->updatePoll(snapshot);
+
+	if (vmeterbridge != 0 && vmeterbridge->raster != 0)
+		vsysinfo->updateRaster(vmeterbridge->raster);
+}
+
+/*
+ * Return the part of a widget inside the scroll area viewport, in
+ * the widget's coordinates. Unlike visibleRegion() this does not
+ * allocate.
+ */
+QRect
+VOSSMainWindow :: visibleRect(const QWidget *w) const
+{
+	const QWidget *vp = viewport();
+
+	if (!w->isVisible() || !vp->isAncestorOf(w))
+		return (QRect());
+
+	return (QRect(-w->mapTo(vp, QPoint(0, 0)), vp->size()) & w->rect());
 }
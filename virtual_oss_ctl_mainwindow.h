@@ -27,6 +27,24 @@
 #define	_VIRTUAL_OSS_CTL_MAINWINDOW_H_
 
 #include "virtual_oss_ctl.h"
+#include "virtual_oss_ctl_session.h"
+#include "virtual_oss_ctl_state.h"
+#include "virtual_oss_ctl_topology.h"
+
+#define	VBAR_HEIGHT 32
+#define	VBAR_WIDTH 128
+#define	VOSS_HOTPLUG_INTERVAL 2000	/* ms */
+#define	VOSS_STATS_INTERVAL 1000	/* ms */
+#define	VOSS_ALLOC_WARMUP 64		/* ticks */
+#define	VOSS_WRITE_DELAY 16	/* ms, about one frame */
+
+enum {
+	VOSS_REPLAY_INFO = 1,
+	VOSS_REPLAY_LIMIT = 2,
+};
+
+extern int convertPeak(long long, uint8_t);
+extern const QColor voss_bar_colors[8];
 
 class VOSSVolumeBar : public QWidget
 {
@@ -36,18 +54,18 @@ public:
 	VOSSVolumeBar(VOSSController *parent = 0, int type = 0, int chan = 0, int num = 0);
 	~VOSSVolumeBar();
 
-	void drawBar(QPainter &, int, int, int);
+	static void drawBar(QPainter &, int, int, int);
+	void refresh(const VOSSPeak *);
 
 	VOSSController *parent;
 
-	struct virtual_oss_io_peak io_peak;
-	struct virtual_oss_mon_peak mon_peak;
-	struct virtual_oss_master_peak master_peak;
-
 	int type;
 	int channel;
 	int number;
-	int generation;
+
+	/* last rendered bar widths, -1 when there is no data */
+	int rx_width;
+	int tx_width;
 
 	void paintEvent(QPaintEvent *);
 };
@@ -65,6 +83,7 @@ public:
 	QGridLayout *gl;
 
 	QLabel *lbl_status;
+	char status_shown[128];
 
 	QPushButton *but_reset;
 	QPushButton *but_enable_disable;
@@ -73,7 +92,17 @@ public:
 	QSpinBox *spn_channel_in;
 	QSpinBox *spn_channel_out;
 
+	/* write-through copy of the device locator state */
+	struct virtual_oss_audio_delay_locator cache;
+	int cache_valid;
+	uint64_t cache_after;
+
+	int fetch();
+	int commit();
+	void invalidate();
+
 	void read_state();
+	void read_state(const struct virtual_oss_audio_delay_locator *, uint64_t);
 
 public slots:
 	void handle_reset();
@@ -134,12 +163,70 @@ public:
 	~VOSSSysInfoOptions();
 
 	void updateInfo();
+	void updatePoll(const VOSSPollSnapshot *);
+	void updateRaster(VOSSMeterRaster *);
+	void updateStartup(uint64_t);
 
 	VOSSMainWindow *parent;
 
 	QGridLayout *gl;
 
 	QLabel lbl_status;
+	QLabel lbl_poll;
+	QLabel lbl_raster;
+	QLabel lbl_startup;
+	QLabel lbl_io;
+	QLabel lbl_session;
+	QLabel lbl_profile;
+	QPushButton *but_dump;
+};
+
+/*
+ * Lightweight record for a single mixer channel. Records exist for
+ * every channel, while editor widgets only exist for the rows inside
+ * the viewport and are bound to a record on demand.
+ */
+class VOSSChannel
+{
+public:
+	VOSSChannel(int, int, int, int);
+	~VOSSChannel();
+
+	int type;	/* -1 if the channel was removed */
+	int channel;
+	int number;
+	int slot;	/* index into the mixer state */
+
+	int has_rx_eq;
+	int has_tx_eq;
+
+	QString title;
+
+	QLabel *connect_input_title;
+	QLabel *connect_output_title;
+	QLineEdit *connect_input_label;
+	QLineEdit *connect_output_label;
+
+	uint32_t connect_row;
+
+	/* windows created on first open */
+	VOSSEqualizer *rx_eq;
+	VOSSEqualizer *tx_eq;
+	VOSSCompressor *compressor_edit;
+
+	/* editor currently bound to this record, if any */
+	VOSSController *view;
+
+	/* last configuration change seen by the poller */
+	uint32_t info_serial;
+	/* ignore read backs older than this poller read */
+	uint64_t reconcile_after;
+
+	/* configuration is waiting in the write-behind queue */
+	int dirty;
+
+	/* VOSS_REPLAY_XXX, writes which failed and are redone on reconnect */
+	int replay;
 };
 
 class VOSSController : public QGroupBox
@@ -147,18 +234,20 @@ class VOSSController : public QGroupBox
 	Q_OBJECT;
 
 public:
-	VOSSController(VOSSMainWindow *parent = 0, int type = 0, int channel = 0, int number = 0);
+	VOSSController(VOSSMainWindow *parent = 0, int type = 0);
 	~VOSSController();
 
-	void set_desc(const char *);
 	void set_rx_amp(int);
 	void set_tx_amp(int);
 
-	void get_config(void);
+	void bind(VOSSChannel *);
+	void unbind(void);
+	void read_state(int = VOSS_FIELD_ALL);
 
-	void watchdog(void);
+	int watchdog(void);
 
 	VOSSMainWindow *parent;
+	VOSSChannel *pc;
 
 	QGridLayout *gl;
 
@@ -175,15 +264,7 @@ public:
 
 	QPushButton *rx_eq_show;
 	QPushButton *tx_eq_show;
-	VOSSEqualizer *rx_eq;
-	VOSSEqualizer *tx_eq;
 
-	QLineEdit *connect_input_label;
-	QLineEdit *connect_output_label;
-
-	uint32_t connect_row;
-
-	VOSSCompressor *compressor_edit;
 	QPushButton *compressor;
 	QSpinBox *spn_rx_chn;
 	QSpinBox *spn_tx_chn;
@@ -194,11 +275,7 @@ public:
 	int type;
 	int channel;
 	int number;
-	int rx_amp;
-	int tx_amp;
-
-	struct virtual_oss_io_info io_info;
-	struct virtual_oss_mon_info mon_info;
+	int slot;	/* index into the mixer state, -1 when unbound */
 
 public slots:
 	void handle_rx_amp_up(void);
@@ -216,17 +293,53 @@ class VOSSMainWindow : public QScrollArea
 	Q_OBJECT;
 
 public:
-	VOSSMainWindow(const char *dsp = 0);
+	VOSSMainWindow(const char *dsp = 0, int use_meterbridge = 0,	/* 2 = threaded */
+	    int write_delay = VOSS_WRITE_DELAY, int show_profile = 0);
 	~VOSSMainWindow();
 
 	VOSSEqualizer *eq_copy;
 	VOSSCompressor *compressor_copy;
 
-	VOSSGridLayout *gl_ctl;
+	VOSSStripList *gl_ctl;
 
 	VOSSGridLayout *gl_main;
 
-	VOSSController *vb[MAX_VOLUME_BAR];
+	/* all channel records, indexed by slot */
+	QVector<VOSSChannel *> vb;
+
+	/* channel index, keyed by type, number and channel */
+	QHash<quint64, VOSSChannel *> vb_index;
+
+	static quint64 key(int type, int number, int channel) {
+		return (((quint64)(quint16)type << 48) |
+		    ((quint64)(quint16)number << 32) | (quint32)channel);
+	};
+
+	VOSSChannel *lookup(int, int, int) const;
+	void slot_order(QVector<int> &) const;
+	void get_config(int);
+	void load_config(int, const VOSSTopologyEntry &);
+
+	/* mixer state, indexed by controller slot */
+	VOSSMixerState state;
+
+	/* result of the last channel discovery */
+	VOSSTopology topology;
+	VOSSTopologyVerify *verify;
+	int verify_stale;	/* "verify" started before a reconnect */
+	int discovered;		/* "topology" was checked against the device */
+
+	void populate(void);
+	void rebuild(void);
+	void verify_topology(void);
+	void apply_hotplug(void);
+	void make_poller(void);
+	VOSSChannel *add_channel(const VOSSTopologyEntry &);
+	void remove_channel(int);
+	void reconcile(int, const VOSSPollSlot &);
+	void queue_write(int);
+	int write_config(int);
+	int write_limit(int);
 
 	VOSSConnect *vconnect;
 
@@ -235,15 +348,46 @@ public:
 	VOSSRecordStatus *vrecordstatus;
 	VOSSAddOptions *vaddoptions;
 	VOSSSysInfoOptions *vsysinfo;
+	VOSSMeterBridge *vmeterbridge;
 
 	QTimer *watchdog;
+	QTimer *hotplug;
+	VOSSTopologyHotplug *hotplug_scan;
+	int hotplug_stale;	/* "hotplug_scan" started before a reconnect */
+	QTimer *stats;
+	QTimer *heartbeat;
+
+	/* write-behind queue of slots, flushed by "flush" */
+	QVector<int> pending;
+	QTimer *flush;
+	uint32_t n_writes;
+	uint32_t n_coalesced;
+
+	VOSSPoller *poller;
+	const VOSSPollSnapshot *snapshot;
+
+	const VOSSPollSlot *poll_slot(int) const;
+	const VOSSPeak *poll_peak(int) const;
+	int poll_wanted(int);
+	QRect visibleRect(const QWidget *) const;
 
 	const char *dsp_name;
-	int dsp_fd;
-	int generation;
+	VOSSSession *session;
+	uint64_t reconnect_serial;
+
+	QElapsedTimer startup;
+	uint64_t startup_usec;
+	int meterbridge_mode;
+	int show_profile;
 
 public slots:
 	void handle_watchdog(void);
+	void handle_hotplug(void);
+	void handle_stats(void);
+	void handle_dump(void);
+	void handle_heartbeat(void);
+	void handle_flush(void);
+	void handle_reconnect(void);
 };
 
 #endif		/* _VIRTUAL_OSS_CTL_MAINWINDOW_H_ */
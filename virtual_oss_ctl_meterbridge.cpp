@@ -0,0 +1,417 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_mainwindow.h"
+#include "virtual_oss_ctl_meterbridge.h"
+#include "virtual_oss_ctl_poller.h"
+#include "virtual_oss_ctl_profile.h"
+
+static void
+voss_raster_copy(QVector<int> &dst, const QVector<int> &src)
+{
+	if (dst.size() != src.size())
+		dst.resize(src.size());
+	if (src.size() != 0)
+		memcpy(dst.data(), src.constData(), src.size() * sizeof(int));
+}
+
+static void
+voss_raster_copy(QVector<char> &dst, const QVector<char> &src)
+{
+	if (dst.size() != src.size())
+		dst.resize(src.size());
+	if (src.size() != 0)
+		memcpy(dst.data(), src.constData(), src.size());
+}
+
+VOSSMeterRaster :: VOSSMeterRaster(VOSSMeterBridge *_parent)
+{
+	parent = _parent;
+
+	/* QPixmap is not thread safe, use a QImage copy */
+	background = parent->background.toImage();
+	image[0] = background;
+	image[1] = background;
+	image[0].detach();
+	image[1].detach();
+
+	job_rx.resize(parent->rx_width.size());
+	job_tx.resize(parent->tx_width.size());
+	job_stereo.resize(parent->stereo.size());
+	job_pending = 0;
+	shown = 0;
+
+	frames = 0;
+	dropped = 0;
+	sum_usec = 0;
+	min_usec = 0;
+	max_usec = 0;
+}
+
+VOSSMeterRaster :: ~VOSSMeterRaster()
+{
+	mtx.lock();
+	requestInterruption();
+	cv.wakeOne();
+	mtx.unlock();
+
+	wait();
+}
+
+void
+VOSSMeterRaster :: submit(const QVector<int> &rx, const QVector<int> &tx,
+    const QVector<char> &stereo)
+{
+	mtx.lock();
+	if (job_pending)
+		dropped++;
+	/*
+	 * Copy the widths and the row layout instead of sharing the
+	 * vectors. A shared vector detaches, and thereby allocates,
+	 * on the next write by the GUI thread, and the GUI thread
+	 * owns the layout.
+	 */
+	voss_raster_copy(job_rx, rx);
+	voss_raster_copy(job_tx, tx);
+	voss_raster_copy(job_stereo, stereo);
+	job_pending = 1;
+	cv.wakeOne();
+	mtx.unlock();
+}
+
+void
+VOSSMeterRaster :: blit(QPainter &paint, const QRect &r)
+{
+	mtx.lock();
+	paint.drawImage(r, image[shown], r);
+	mtx.unlock();
+}
+
+void
+VOSSMeterRaster :: stats(char *buf, size_t size)
+{
+	mtx.lock();
+	snprintf(buf, size, "Meter frames %llu, dropped %llu, "
+	    "frame time min/avg/max %u/%u/%u us",
+	    (unsigned long long)frames, (unsigned long long)dropped,
+	    (unsigned)min_usec,
+	    (unsigned)(frames ? (sum_usec / frames) : 0),
+	    (unsigned)max_usec);
+	mtx.unlock();
+}
+
+void
+VOSSMeterRaster :: render(QImage &img, const QVector<int> &rx,
+    const QVector<int> &tx, const QVector<char> &stereo)
+{
+	const char *ps = stereo.constData();
+	QColor split(192,192,0);
+	int base;
+	int w;
+	int x;
+	int y;
+
+	QPainter paint(&img);
+
+	paint.drawImage(0, 0, background);
+	paint.translate(VMB_LABEL, 0);
+
+	for (y = 0; y != rx.size() && y != stereo.size(); y++) {
+		if (rx[y] < 0)
+			continue;
+
+		base = y * VMB_PITCH;
+
+		if (ps[y]) {
+			VOSSVolumeBar::drawBar(paint, base, VBAR_HEIGHT / 2, rx[y]);
+			VOSSVolumeBar::drawBar(paint, base + VBAR_HEIGHT / 2,
+			    VBAR_HEIGHT / 2, tx[y]);
+		} else {
+			VOSSVolumeBar::drawBar(paint, base, VBAR_HEIGHT / 2, rx[y]);
+		}
+
+		for (x = 1; x != 8; x++) {
+			QColor white(192,192,192 - x * 16);
+			w = (x * VBAR_WIDTH) / 8;
+			paint.fillRect(w, base, 1,
+			    ps[y] ? VBAR_HEIGHT : (VBAR_HEIGHT / 2), white);
+		}
+		if (ps[y])
+			paint.fillRect(0, base + VBAR_HEIGHT / 2, VBAR_WIDTH, 1, split);
+	}
+}
+
+void
+VOSSMeterRaster :: run()
+{
+	QVector<int> rx;
+	QVector<int> tx;
+	QVector<char> stereo;
+	uint64_t start;
+	uint32_t delta;
+	int draw;
+
+	mtx.lock();
+	while (1) {
+		while (job_pending == 0 && !isInterruptionRequested())
+			cv.wait(&mtx);
+
+		if (isInterruptionRequested())
+			break;
+
+		voss_raster_copy(rx, job_rx);
+		voss_raster_copy(tx, job_tx);
+		voss_raster_copy(stereo, job_stereo);
+		job_pending = 0;
+		draw = shown ^ 1;
+		mtx.unlock();
+
+		start = voss_usec();
+		render(image[draw], rx, tx, stereo);
+		delta = voss_usec() - start;
+
+		mtx.lock();
+		shown = draw;
+		if (frames == 0 || delta < min_usec)
+			min_usec = delta;
+		if (delta > max_usec)
+			max_usec = delta;
+		sum_usec += delta;
+		frames++;
+
+		QMetaObject::invokeMethod(parent, "update", Qt::QueuedConnection);
+	}
+	mtx.unlock();
+}
+
+VOSSMeterBridge :: VOSSMeterBridge(VOSSMainWindow *_parent, int threaded)
+{
+	VOSSChannel *pc;
+	int x;
+
+	parent = _parent;
+	raster = 0;
+	dirty = 0;
+
+	/* every slot has a row, removed channels leave theirs blank */
+	for (x = 0; x != parent->vb.size(); x++) {
+		pc = parent->vb[x];
+		if (pc == 0 || pc->type < 0) {
+			stereo.append(0);
+			continue;
+		}
+		switch (pc->type) {
+		case VOSS_TYPE_DEVICE:
+		case VOSS_TYPE_LOOPBACK:
+			stereo.append(1);
+			break;
+		default:
+			stereo.append(0);
+			break;
+		}
+	}
+
+	n_rows = stereo.size();
+
+	rx_width.fill(-1, n_rows);
+	tx_width.fill(-1, n_rows);
+
+	setFixedSize(VMB_LABEL + VBAR_WIDTH, n_rows * VMB_PITCH);
+
+	render_background();
+
+	if (threaded) {
+		raster = new VOSSMeterRaster(this);
+		raster->start();
+	}
+}
+
+VOSSMeterBridge :: ~VOSSMeterBridge()
+{
+	delete raster;
+}
+
+QRect
+VOSSMeterBridge :: rowRect(int x) const
+{
+	return (QRect(VMB_LABEL, x * VMB_PITCH, VBAR_WIDTH, VBAR_HEIGHT));
+}
+
+int
+VOSSMeterBridge :: rowVisible(const QRect &region, int x) const
+{
+	if (x < 0 || x >= n_rows)
+		return (0);
+	return (region.intersects(rowRect(x)));
+}
+
+void
+VOSSMeterBridge :: render_background(void)
+{
+	QColor black(0,0,0);
+	QColor split(192,192,0);
+	int x;
+	int y;
+	int w;
+
+	background = QPixmap(size());
+	background.fill(palette().color(QPalette::Window));
+
+	if (n_rows == 0)
+		return;
+
+	QPainter paint(&background);
+
+	for (y = 0; y != n_rows; y++) {
+		const int base = y * VMB_PITCH;
+		const int h = stereo[y] ? VBAR_HEIGHT : (VBAR_HEIGHT / 2);
+
+		/* leave the rows of removed channels blank */
+		if (parent->vb[y] == 0 || parent->vb[y]->type < 0)
+			continue;
+
+		paint.setPen(palette().color(QPalette::WindowText));
+		paint.drawText(QRect(0, base, VMB_LABEL - 4, h),
+		    Qt::AlignRight | Qt::AlignVCenter, parent->vb[y]->title);
+
+		paint.fillRect(VMB_LABEL, base, VBAR_WIDTH, h, black);
+
+		for (x = 1; x != 8; x++) {
+			QColor white(192,192,192 - x * 16);
+			w = (x * VBAR_WIDTH) / 8;
+			paint.fillRect(VMB_LABEL + w, base, 1, h, white);
+		}
+		if (stereo[y])
+			paint.fillRect(VMB_LABEL, base + VBAR_HEIGHT / 2, VBAR_WIDTH, 1, split);
+	}
+}
+
+void
+VOSSMeterBridge :: drawLevel(QPainter &paint, int y, int h, int level)
+{
+	const int d = (VBAR_WIDTH / 8);
+	int x;
+
+	/* same segments as VOSSVolumeBar::drawBar(), then the tick marks */
+	for (x = 0; level > 0; level -= d, x += d) {
+		paint.fillRect(VMB_LABEL + x, y, (level >= d) ? d : level, h,
+		    voss_bar_colors[x / d]);
+		if (x != 0) {
+			QColor white(192,192,192 - (x / d) * 16);
+			paint.fillRect(VMB_LABEL + x, y, 1, h, white);
+		}
+	}
+}
+
+void
+VOSSMeterBridge :: refresh(int x, const VOSSPeak *pk)
+{
+	int rx;
+	int tx;
+
+	if (x < 0 || x >= n_rows)
+		return;
+
+	if (pk == 0 || pk->valid == 0) {
+		rx = tx = -1;
+	} else {
+		rx = convertPeak(pk->rx, pk->bits);
+		tx = convertPeak(pk->tx, pk->bits);
+	}
+
+	if (rx == rx_width[x] && tx == tx_width[x])
+		return;
+
+	rx_width[x] = rx;
+	tx_width[x] = tx;
+
+	if (raster != 0) {
+		dirty = 1;
+	} else {
+		VOSS_DEBUG_REPAINT(update(rowRect(x)));
+	}
+}
+
+void
+VOSSMeterBridge :: flush(void)
+{
+	if (dirty == 0)
+		return;
+	dirty = 0;
+
+	raster->submit(rx_width, tx_width, stereo);
+}
+
+void
+VOSSMeterBridge :: paintEvent(QPaintEvent *event)
+{
+	const QRegion &region = event->region();
+	QRegion::const_iterator it;
+	int first;
+	int last;
+	int base;
+	int y;
+
+	VOSSProfileScope scope(VOSS_PROF_PAINT);
+	QPainter paint(this);
+
+	/*
+	 * Updates of rows far apart are merged into one region, so
+	 * only paint its rectangles, not its bounding rectangle.
+	 */
+	for (it = region.begin(); it != region.end(); ++it) {
+		const QRect &r = *it;
+
+		if (raster != 0) {
+			raster->blit(paint, r);
+			continue;
+		}
+
+		paint.drawPixmap(r, background, r);
+
+		first = r.top() / VMB_PITCH;
+		last = r.bottom() / VMB_PITCH;
+		if (first < 0)
+			first = 0;
+		if (last >= n_rows)
+			last = n_rows - 1;
+
+		/* only rows inside the damaged area are drawn */
+		for (y = first; y <= last; y++) {
+			if (rx_width[y] < 0)
+				continue;
+
+			base = y * VMB_PITCH;
+
+			if (stereo[y]) {
+				drawLevel(paint, base, VBAR_HEIGHT / 2, rx_width[y]);
+				drawLevel(paint, base + VBAR_HEIGHT / 2 + 1,
+				    VBAR_HEIGHT / 2 - 1, tx_width[y]);
+			} else {
+				drawLevel(paint, base, VBAR_HEIGHT / 2, rx_width[y]);
+			}
+		}
+	}
+}
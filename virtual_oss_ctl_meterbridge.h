@@ -0,0 +1,117 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_METERBRIDGE_H_
+#define	_VOSS_CTL_METERBRIDGE_H_
+
+#include "virtual_oss_ctl.h"
+
+#define	VMB_LABEL 192
+#define	VMB_PITCH (VBAR_HEIGHT + 2)
+
+/*
+ * The meter raster thread renders complete meter bridge frames into
+ * a double buffered QImage, using the same bar gradient as the
+ * per-strip meters. Only one frame request is kept pending. If the
+ * thread falls behind, older requests are dropped instead of queued.
+ */
+class VOSSMeterRaster : public QThread
+{
+public:
+	VOSSMeterRaster(VOSSMeterBridge *);
+	~VOSSMeterRaster();
+
+	void submit(const QVector<int> &, const QVector<int> &,
+	    const QVector<char> &);
+	void blit(QPainter &, const QRect &);
+	void stats(char *, size_t);
+
+	void run();
+
+private:
+	void render(QImage &, const QVector<int> &, const QVector<int> &,
+	    const QVector<char> &);
+
+	VOSSMeterBridge *parent;
+
+	QImage background;
+	QImage image[2];
+
+	QMutex mtx;
+	QWaitCondition cv;
+
+	/* pending frame request */
+	QVector<int> job_rx;
+	QVector<int> job_tx;
+	QVector<char> job_stereo;
+	int job_pending;
+
+	int shown;		/* image index visible to the GUI thread */
+
+	/* statistics, protected by mtx */
+	uint64_t frames;
+	uint64_t dropped;
+	uint64_t sum_usec;
+	uint32_t min_usec;
+	uint32_t max_usec;
+};
+
+/*
+ * The meter bridge draws the meters of all channels in a single
+ * widget. Channel names, meter backgrounds and tick marks are
+ * rendered once into a pixmap, so that a paint pass only has to
+ * blit the damaged area and fill the level rectangles of the
+ * meters that changed.
+ */
+class VOSSMeterBridge : public QWidget
+{
+public:
+	VOSSMeterBridge(VOSSMainWindow *, int);
+	~VOSSMeterBridge();
+
+	void refresh(int, const VOSSPeak *);
+	void flush(void);
+	int rowVisible(const QRect &, int) const;
+	QRect rowRect(int) const;
+
+	void render_background(void);
+	void drawLevel(QPainter &, int, int, int);
+
+	void paintEvent(QPaintEvent *);
+
+	VOSSMainWindow *parent;
+	VOSSMeterRaster *raster;
+
+	QPixmap background;
+
+	QVector<int> rx_width;
+	QVector<int> tx_width;
+	QVector<char> stereo;
+
+	int n_rows;
+	int dirty;
+};
+
+#endif		/* _VOSS_CTL_METERBRIDGE_H_ */
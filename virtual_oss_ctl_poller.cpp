@@ -0,0 +1,560 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_io.h"
+#include "virtual_oss_ctl_poller.h"
+
+enum {
+	VOSS_POLL_FRESH = 4,
+	VOSS_POLL_INDEX = 3,
+};
+
+VOSSPoller :: VOSSPoller(const char *dsp, const QVector<VOSSPollEntry> &_table, int _interval)
+  : serial_published(0), serial_read(0), wanted_locator(1), paused(0), shared(2)
+{
+	dsp_name = dsp;
+	dsp_fd = -1;
+	interval = _interval;
+	serial = 0;
+	table = _table;
+	wanted.fill(QAtomicInt(VOSS_POLL_PEAK | VOSS_POLL_LIMIT), table.size());
+
+	current.peak.fill(VOSSPeak(), table.size());
+	current.slot.fill(VOSSPollSlot(), table.size());
+
+	info_hash.fill(0, table.size());
+	info_seeded.fill(0, table.size());
+	reconcile_next = 0;
+
+	rate.resize(table.size());
+	heap.reserve(table.size());
+	for (int x = 0; x != table.size(); x++) {
+		rate[x].period = VOSS_POLL_FAST * 1000;
+		rate[x].skip_due = 0;
+		rate[x].last_rx = 0;
+		rate[x].last_tx = 0;
+		heap_push(0, x);
+	}
+
+	/* version, locator, reconciler, all peaks and all limits */
+	n_queries = 2 + VOSS_RECONCILE_BUDGET + table.size();
+	for (int x = 0; x != table.size(); x++)
+		n_queries += (table[x].limit != 0);
+
+	avoided_start = 0;
+	avoided = 0;
+	avoided_rate = 0;
+	back = 0;
+	front = 1;
+}
+
+VOSSPoller :: ~VOSSPoller()
+{
+	requestInterruption();
+	wait();
+
+	if (dsp_fd > -1)
+		voss_io.close(dsp_fd);
+}
+
+int
+VOSSPoller :: poll_peak(const VOSSPollEntry &pe, VOSSPeak &peak)
+{
+	struct virtual_oss_io_peak io_peak;
+	struct virtual_oss_mon_peak mon_peak;
+	struct virtual_oss_master_peak master_peak;
+	int error;
+
+	switch (pe.type) {
+	case VOSS_TYPE_DEVICE:
+	case VOSS_TYPE_LOOPBACK:
+		memset(&io_peak, 0, sizeof(io_peak));
+		io_peak.number = pe.number;
+		io_peak.channel = pe.channel;
+		error = voss_io.ioctl(VOSS_IO_POLL, dsp_fd, (pe.type == VOSS_TYPE_DEVICE) ?
+		    VIRTUAL_OSS_GET_DEV_PEAK : VIRTUAL_OSS_GET_LOOP_PEAK, &io_peak);
+		if (error)
+			break;
+		peak.rx = io_peak.rx_peak_value;
+		peak.tx = io_peak.tx_peak_value;
+		peak.bits = io_peak.bits;
+		break;
+	case VOSS_TYPE_INPUT_MON:
+	case VOSS_TYPE_OUTPUT_MON:
+	case VOSS_TYPE_LOCAL_MON:
+		memset(&mon_peak, 0, sizeof(mon_peak));
+		mon_peak.number = pe.number;
+		error = voss_io.ioctl(VOSS_IO_POLL, dsp_fd, (pe.type == VOSS_TYPE_INPUT_MON) ?
+		    VIRTUAL_OSS_GET_INPUT_MON_PEAK : (pe.type == VOSS_TYPE_OUTPUT_MON) ?
+		    VIRTUAL_OSS_GET_OUTPUT_MON_PEAK : VIRTUAL_OSS_GET_LOCAL_MON_PEAK, &mon_peak);
+		if (error)
+			break;
+		peak.rx = mon_peak.peak_value;
+		peak.tx = 0;
+		peak.bits = mon_peak.bits;
+		break;
+	case VOSS_TYPE_MAIN_OUTPUT:
+	case VOSS_TYPE_MAIN_INPUT:
+		memset(&master_peak, 0, sizeof(master_peak));
+		master_peak.channel = pe.channel;
+		error = voss_io.ioctl(VOSS_IO_POLL, dsp_fd, (pe.type == VOSS_TYPE_MAIN_OUTPUT) ?
+		    VIRTUAL_OSS_GET_OUTPUT_PEAK : VIRTUAL_OSS_GET_INPUT_PEAK, &master_peak);
+		if (error)
+			break;
+		peak.rx = master_peak.peak_value;
+		peak.tx = 0;
+		peak.bits = master_peak.bits;
+		break;
+	default:
+		error = EINVAL;
+		break;
+	}
+	peak.valid = (error == 0);
+	return (error);
+}
+
+int
+VOSSPoller :: poll_limit(const VOSSPollEntry &pe, struct virtual_oss_compressor &limit)
+{
+	struct virtual_oss_io_limit io_limit;
+	int error;
+
+	switch (pe.type) {
+	case VOSS_TYPE_MAIN_OUTPUT:
+		memset(&limit, 0, sizeof(limit));
+		return (voss_io.ioctl(VOSS_IO_POLL, dsp_fd, VIRTUAL_OSS_GET_OUTPUT_LIMIT, &limit));
+	case VOSS_TYPE_DEVICE:
+		memset(&io_limit, 0, sizeof(io_limit));
+		io_limit.number = pe.number;
+		error = voss_io.ioctl(VOSS_IO_POLL, dsp_fd, VIRTUAL_OSS_GET_DEV_LIMIT, &io_limit);
+		break;
+	case VOSS_TYPE_LOOPBACK:
+		memset(&io_limit, 0, sizeof(io_limit));
+		io_limit.number = pe.number;
+		error = voss_io.ioctl(VOSS_IO_POLL, dsp_fd, VIRTUAL_OSS_GET_LOOP_LIMIT, &io_limit);
+		break;
+	default:
+		return (EINVAL);
+	}
+	if (error == 0)
+		limit = io_limit.param;
+	return (error);
+}
+
+void
+VOSSPoller :: heap_push(uint64_t when, int x)
+{
+	VOSSPollDeadline pd;
+	int i;
+
+	pd.when = when;
+	pd.slot = x;
+
+	heap.append(pd);
+
+	/* sift up */
+	for (i = heap.size() - 1; i > 0; ) {
+		int p = (i - 1) / 2;
+		if (heap[p].when <= heap[i].when)
+			break;
+		qSwap(heap[p], heap[i]);
+		i = p;
+	}
+}
+
+void
+VOSSPoller :: heap_pop(void)
+{
+	int n = heap.size() - 1;
+	int i;
+
+	heap[0] = heap[n];
+	heap.resize(n);
+
+	/* sift down */
+	for (i = 0;; ) {
+		int c = 2 * i + 1;
+		if (c >= n)
+			break;
+		if (c + 1 < n && heap[c + 1].when < heap[c].when)
+			c++;
+		if (heap[i].when <= heap[c].when)
+			break;
+		qSwap(heap[i], heap[c]);
+		i = c;
+	}
+}
+
+void
+VOSSPoller :: rate_update(int x, const VOSSPeak &peak)
+{
+	VOSSPollRate &pr = rate[x];
+
+	if (peak.valid && (peak.rx != pr.last_rx || peak.tx != pr.last_tx)) {
+		/* signal is changing - poll fast */
+		pr.period = VOSS_POLL_FAST * 1000;
+	} else {
+		/* silent or flat - back off */
+		pr.period *= 2;
+		if (pr.period > VOSS_POLL_SLOW * 1000)
+			pr.period = VOSS_POLL_SLOW * 1000;
+	}
+	pr.last_rx = peak.rx;
+	pr.last_tx = peak.tx;
+}
+
+void
+VOSSPoller :: tick(void)
+{
+	uint32_t skipped = 0;
+	int x;
+
+	current.online = 0;
+	current.locator_valid = 0;
+
+	if (dsp_fd < 0)
+		dsp_fd = voss_io.open(dsp_name);
+
+	if (dsp_fd < 0)
+		return;
+
+	if (voss_io.ioctl(VOSS_IO_POLL, dsp_fd, VIRTUAL_OSS_GET_VERSION, &x) != 0) {
+		voss_io.close(dsp_fd);
+		dsp_fd = -1;
+		return;
+	}
+
+	current.online = 1;
+
+	for (x = 0; x != table.size(); x++) {
+		const VOSSPollEntry &pe = table[x];
+		VOSSPollSlot &sl = current.slot[x];
+
+		sl.limit_valid = 0;
+
+		if (pe.limit == 0)
+			continue;
+		else if (wanted[x].loadAcquire() & VOSS_POLL_LIMIT)
+			sl.limit_valid = (poll_limit(pe, sl.limit) == 0);
+		else
+			skipped++;
+	}
+
+	if (wanted_locator.loadAcquire()) {
+		current.locator_serial = read_begin();
+		current.locator_valid = (voss_io.ioctl(VOSS_IO_POLL, dsp_fd,
+		    VIRTUAL_OSS_GET_AUDIO_DELAY_LOCATOR, &current.locator) == 0);
+	} else {
+		skipped++;
+	}
+
+	reconcile();
+
+	avoid(skipped);
+}
+
+static uint32_t
+voss_fnv1a(const void *ptr, size_t len)
+{
+	const uint8_t *p = (const uint8_t *)ptr;
+	uint32_t hash = 2166136261U;
+
+	while (len--) {
+		hash ^= *p++;
+		hash *= 16777619U;
+	}
+	return (hash);
+}
+
+/*
+ * Number a configuration or locator read which is about to start.
+ * See readSerial().
+ */
+uint64_t
+VOSSPoller :: read_begin(void)
+{
+	const uint64_t read = serial_read.loadAcquire() + 1;
+
+	serial_read.storeRelease(read);
+	return (read);
+}
+
+/*
+ * Re-read the configuration of the next few slots. The first read of
+ * a slot only seeds its hash, since the GUI thread has read the
+ * configuration itself at startup.
+ */
+void
+VOSSPoller :: reconcile(void)
+{
+	struct virtual_oss_io_info io_info;
+	struct virtual_oss_mon_info mon_info;
+	unsigned long cmd;
+	uint64_t read;
+	uint32_t hash;
+	int budget = VOSS_RECONCILE_BUDGET;
+	int n;
+
+	for (n = 0; n != table.size() && budget != 0; n++) {
+		const int x = reconcile_next;
+		const VOSSPollEntry &pe = table[x];
+		VOSSPollSlot &sl = current.slot[x];
+
+		if (++reconcile_next == table.size())
+			reconcile_next = 0;
+
+		switch (pe.type) {
+		case VOSS_TYPE_DEVICE:
+		case VOSS_TYPE_LOOPBACK:
+			memset(&io_info, 0, sizeof(io_info));
+			io_info.number = pe.number;
+			io_info.channel = pe.channel;
+			budget--;
+			read = read_begin();
+			if (voss_io.ioctl(VOSS_IO_POLL, dsp_fd, (pe.type == VOSS_TYPE_DEVICE) ?
+			    VIRTUAL_OSS_GET_DEV_INFO : VIRTUAL_OSS_GET_LOOP_INFO, &io_info) != 0)
+				continue;
+			sl.info_read = read;
+			hash = voss_fnv1a(&io_info, sizeof(io_info));
+			if (hash == info_hash[x] && info_seeded[x])
+				continue;
+			sl.io_info = io_info;
+			break;
+		case VOSS_TYPE_INPUT_MON:
+		case VOSS_TYPE_OUTPUT_MON:
+		case VOSS_TYPE_LOCAL_MON:
+			memset(&mon_info, 0, sizeof(mon_info));
+			mon_info.number = pe.number;
+			if (pe.type == VOSS_TYPE_INPUT_MON)
+				cmd = VIRTUAL_OSS_GET_INPUT_MON_INFO;
+			else if (pe.type == VOSS_TYPE_OUTPUT_MON)
+				cmd = VIRTUAL_OSS_GET_OUTPUT_MON_INFO;
+			else
+				cmd = VIRTUAL_OSS_GET_LOCAL_MON_INFO;
+			budget--;
+			read = read_begin();
+			if (voss_io.ioctl(VOSS_IO_POLL, dsp_fd, cmd, &mon_info) != 0)
+				continue;
+			sl.info_read = read;
+			hash = voss_fnv1a(&mon_info, sizeof(mon_info));
+			if (hash == info_hash[x] && info_seeded[x])
+				continue;
+			sl.mon_info = mon_info;
+			break;
+		default:
+			/* master channels have no configuration */
+			continue;
+		}
+		info_hash[x] = hash;
+		if (info_seeded[x] == 0) {
+			info_seeded[x] = 1;
+			continue;
+		}
+		sl.info_serial++;
+		current.reconcile_changes++;
+	}
+}
+
+int
+VOSSPoller :: sweep(uint64_t now)
+{
+	const uint64_t recheck = (uint64_t)interval * 1000;
+	uint64_t start = now;
+	uint64_t n;
+	uint32_t skipped = 0;
+	int count = 0;
+
+	/* gather all visible peaks that are due in one pass */
+	while (heap.size() != 0 && heap[0].when <= now) {
+		const int x = heap[0].slot;
+		VOSSPeak &peak = current.peak[x];
+		VOSSPollRate &pr = rate[x];
+
+		heap_pop();
+
+		if (wanted[x].loadAcquire() & VOSS_POLL_PEAK) {
+			pr.skip_due = 0;
+			poll_peak(table[x], peak);
+			rate_update(x, peak);
+			heap_push(now + pr.period, x);
+		} else {
+			peak.valid = 0;
+			/*
+			 * Count the polls the slot's own rate would have
+			 * made, not the checks. A longer gap is a pause,
+			 * which run() accounts for.
+			 */
+			if (pr.skip_due == 0 || pr.skip_due + 2 * recheck < now)
+				pr.skip_due = now;
+			if (pr.skip_due <= now) {
+				n = (now - pr.skip_due) / pr.period + 1;
+				pr.skip_due += n * pr.period;
+				skipped += n;
+			}
+			/* check again soon, in case it becomes visible */
+			heap_push(now + recheck, x);
+		}
+		count++;
+	}
+
+	avoid(skipped);
+
+	if (count != 0)
+		current.sweep_usec = voss_usec() - start;
+	return (count);
+}
+
+void
+VOSSPoller :: avoid(uint32_t skipped)
+{
+	uint64_t now = voss_usec();
+	uint64_t delta;
+
+	avoided += skipped;
+
+	delta = now - avoided_start;
+	if (delta < 1000000ULL)
+		return;
+
+	avoided_rate = (uint32_t)(((uint64_t)avoided * 1000000ULL) / delta);
+	avoided_start = now;
+	avoided = 0;
+}
+
+void
+VOSSPoller :: setWanted(int x, int flags)
+{
+	if (x > -1 && x < wanted.size())
+		wanted[x].storeRelease(flags);
+}
+
+void
+VOSSPoller :: setWantedLocator(int flag)
+{
+	wanted_locator.storeRelease(flag);
+}
+
+void
+VOSSPoller :: setPaused(int flag)
+{
+	paused.storeRelease(flag);
+}
+
+void
+VOSSPoller :: publish()
+{
+	VOSSPollSnapshot &ps = buffer[back];
+	const int n = table.size();
+
+	ps.peak.resize(n);
+	ps.slot.resize(n);
+
+	if (n != 0) {
+		memcpy(ps.peak.data(), current.peak.constData(), sizeof(VOSSPeak) * n);
+		memcpy(ps.slot.data(), current.slot.constData(), sizeof(VOSSPollSlot) * n);
+	}
+
+	ps.locator = current.locator;
+	ps.locator_valid = current.locator_valid;
+	ps.locator_serial = current.locator_serial;
+	ps.online = current.online;
+	ps.sweep_usec = current.sweep_usec;
+	ps.avoided_rate = avoided_rate;
+	ps.reconcile_changes = current.reconcile_changes;
+	ps.serial = ++serial;
+	serial_published.storeRelease(serial);
+
+	back = shared.fetchAndStoreOrdered(back | VOSS_POLL_FRESH) & VOSS_POLL_INDEX;
+}
+
+/* Serial number of the most recently published snapshot */
+uint64_t
+VOSSPoller :: published() const
+{
+	return (serial_published.loadAcquire());
+}
+
+/*
+ * Serial number of the most recent configuration or locator read.
+ * A read started after this call has a higher serial number.
+ */
+uint64_t
+VOSSPoller :: readSerial() const
+{
+	return (serial_read.loadAcquire());
+}
+
+const VOSSPollSnapshot *
+VOSSPoller :: consume()
+{
+	if ((shared.loadAcquire() & VOSS_POLL_FRESH) == 0)
+		return (0);
+
+	front = shared.fetchAndStoreOrdered(front) & VOSS_POLL_INDEX;
+
+	return (&buffer[front]);
+}
+
+void
+VOSSPoller :: run()
+{
+	uint64_t next_tick = 0;
+	uint64_t now;
+	uint64_t next;
+	int changed;
+
+	while (!isInterruptionRequested()) {
+		if (paused.loadAcquire()) {
+			/* window is minimized - don't poll anything */
+			avoid(n_queries);
+			msleep(interval);
+			continue;
+		}
+
+		now = voss_usec();
+		changed = 0;
+
+		if (now >= next_tick) {
+			tick();
+			next_tick = now + (uint64_t)interval * 1000;
+			changed = 1;
+		}
+
+		if (current.online != 0 && sweep(now) != 0)
+			changed = 1;
+
+		if (changed)
+			publish();
+
+		/* sleep until the next deadline */
+		next = next_tick;
+		if (current.online != 0 && heap.size() != 0 && heap[0].when < next)
+			next = heap[0].when;
+
+		now = voss_usec();
+		if (next > now)
+			usleep(next - now);
+	}
+}
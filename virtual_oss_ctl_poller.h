@@ -0,0 +1,193 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_POLLER_H_
+#define	_VOSS_CTL_POLLER_H_
+
+#include "virtual_oss_ctl.h"
+
+enum {
+	VOSS_POLL_PEAK = 1,
+	VOSS_POLL_LIMIT = 2,
+};
+
+/* peak polling period limits, in milliseconds */
+#define	VOSS_POLL_FAST 20
+#define	VOSS_POLL_SLOW 640
+
+/* configuration re-reads per tick */
+#define	VOSS_RECONCILE_BUDGET 2
+
+/* What to poll for a single controller slot */
+struct VOSSPollEntry {
+	int type;
+	int number;
+	int channel;
+	int limit;		/* also poll compressor gain */
+};
+
+/* Peak levels of a single controller slot */
+struct VOSSPeak {
+	long long rx;		/* receive or mono peak value */
+	long long tx;		/* transmit peak value */
+	int bits;
+	int valid;
+};
+
+struct VOSSPollSlot {
+	struct virtual_oss_compressor limit;
+	int limit_valid;
+
+	/* last configuration read back, changes bump "info_serial" */
+	union {
+		struct virtual_oss_io_info io_info;
+		struct virtual_oss_mon_info mon_info;
+	};
+	uint32_t info_serial;
+	uint64_t info_read;	/* see VOSSPoller::readSerial() */
+};
+
+/* Adaptive polling state of a single controller slot */
+struct VOSSPollRate {
+	uint32_t period;	/* in microseconds */
+	uint64_t skip_due;	/* next poll skipped while hidden, or 0 */
+	long long last_rx;
+	long long last_tx;
+};
+
+/* Timer heap element */
+struct VOSSPollDeadline {
+	uint64_t when;		/* in microseconds */
+	int slot;
+};
+
+class VOSSPollSnapshot
+{
+public:
+	VOSSPollSnapshot() : online(0), serial(0), sweep_usec(0), avoided_rate(0),
+	    reconcile_changes(0) {
+		memset(&locator, 0, sizeof(locator));
+		locator_valid = 0;
+		locator_serial = 0;
+	};
+
+	/* indexed by controller slot */
+	QVector<VOSSPeak> peak;
+	QVector<VOSSPollSlot> slot;
+	struct virtual_oss_audio_delay_locator locator;
+	int locator_valid;
+	uint64_t locator_serial;	/* see VOSSPoller::readSerial() */
+	int online;
+	uint64_t serial;
+	uint32_t sweep_usec;	/* duration of the last sweep */
+	uint32_t avoided_rate;	/* ioctls skipped per second */
+	uint32_t reconcile_changes;	/* external changes seen */
+};
+
+/*
+ * The poller thread owns its own file handle to the control device
+ * and sweeps all queries once per tick. Completed snapshots are
+ * handed over to the GUI thread through a lock-free triple buffer,
+ * so that the GUI thread never has to wait for an ioctl.
+ *
+ * Peaks are polled at an adaptive rate. Each slot has its own
+ * deadline kept in a binary min-heap. A slot whose peak is changing
+ * is polled every VOSS_POLL_FAST ms, while a silent or flat slot
+ * backs off exponentially towards VOSS_POLL_SLOW ms.
+ *
+ * Changes made by other clients are picked up by re-reading the
+ * configuration of at most VOSS_RECONCILE_BUDGET slots per tick,
+ * round-robin. Each result is hashed, and only a differing hash
+ * is handed over to the GUI thread.
+ *
+ * All queries use the lowest scheduler class, VOSS_IO_POLL, one
+ * channel at a time, so that user edits can run between any two
+ * channels of a sweep.
+ */
+class VOSSPoller : public QThread
+{
+public:
+	VOSSPoller(const char *, const QVector<VOSSPollEntry> &, int);
+	~VOSSPoller();
+
+	const VOSSPollSnapshot *consume();
+
+	void setWanted(int, int);
+	void setWantedLocator(int);
+	void setPaused(int);
+	uint64_t published() const;
+	uint64_t readSerial() const;
+
+	void run();
+
+private:
+	void tick(void);
+	void reconcile(void);
+	int sweep(uint64_t);
+	void publish();
+	void heap_push(uint64_t, int);
+	void heap_pop(void);
+	void rate_update(int, const VOSSPeak &);
+	void avoid(uint32_t);
+	int poll_peak(const VOSSPollEntry &, VOSSPeak &);
+	int poll_limit(const VOSSPollEntry &, struct virtual_oss_compressor &);
+	uint64_t read_begin(void);
+
+	const char *dsp_name;
+	int dsp_fd;
+	int interval;
+	uint64_t serial;
+	QAtomicInteger<quint64> serial_published;
+	QAtomicInteger<quint64> serial_read;
+
+	QVector<VOSSPollEntry> table;
+	QVector<VOSSPollRate> rate;
+	QVector<VOSSPollDeadline> heap;
+	QVector<uint32_t> info_hash;
+	QVector<char> info_seeded;	/* "info_hash" holds a first read */
+	int reconcile_next;
+
+	/* most recent state, copied into the back buffer when published */
+	VOSSPollSnapshot current;
+
+	/* visibility as seen by the GUI thread, VOSS_POLL_XXX flags */
+	QVector<QAtomicInt> wanted;
+	QAtomicInt wanted_locator;
+	QAtomicInt paused;
+
+	uint32_t n_queries;
+	uint64_t avoided_start;
+	uint32_t avoided;
+	uint32_t avoided_rate;
+
+	VOSSPollSnapshot buffer[3];
+
+	/* bits 0-1: index of shared buffer, bit 2: shared buffer is fresh */
+	QAtomicInt shared;
+	int back;		/* producer only */
+	int front;		/* consumer only */
+};
+
+#endif		/* _VOSS_CTL_POLLER_H_ */
@@ -0,0 +1,147 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_profile.h"
+
+VOSSProfile voss_profile;
+
+static const char *voss_profile_phase[VOSS_PROF_MAX] = {
+	"consume", "mirror", "bind", "meters", "locator", "tick", "paint"
+};
+
+VOSSProfile :: VOSSProfile()
+{
+	reset();
+}
+
+void
+VOSSProfile :: reset(void)
+{
+	memset(stat, 0, sizeof(stat));
+	memset(phase_usec, 0, sizeof(phase_usec));
+	tick_start = 0;
+	phase_start = 0;
+}
+
+void
+VOSSProfile :: begin(void)
+{
+	tick_start = phase_start = voss_usec();
+	memset(phase_usec, 0, sizeof(phase_usec));
+}
+
+/* Close the current phase and start the next one */
+void
+VOSSProfile :: mark(int phase)
+{
+	const uint64_t t = voss_usec();
+
+	phase_usec[phase] += t - phase_start;
+	phase_start = t;
+}
+
+void
+VOSSProfile :: end(void)
+{
+	int x;
+
+	for (x = 0; x != VOSS_PROF_TICK; x++)
+		voss_hist_add(stat[x], phase_usec[x]);
+	voss_hist_add(stat[VOSS_PROF_TICK], phase_start - tick_start);
+}
+
+/* Record a phase which started at "start" and ends now */
+void
+VOSSProfile :: add(int phase, uint64_t start)
+{
+	voss_hist_add(stat[phase], voss_usec() - start);
+}
+
+/* One line summary, "channels" is used to budget the tick per channel */
+void
+VOSSProfile :: format(char *buf, size_t size, int channels)
+{
+	const VOSSHistogram &tick = stat[VOSS_PROF_TICK];
+	size_t len;
+	int x;
+
+	snprintf(buf, size, "Tick p50/p99/max");
+
+	for (x = 0; x != VOSS_PROF_MAX; x++) {
+		len = strlen(buf);
+		snprintf(buf + len, size - len, "%s %s %u/%u/%u",
+		    x ? "," : "", voss_profile_phase[x],
+		    voss_hist_percentile(stat[x], 50),
+		    voss_hist_percentile(stat[x], 99), stat[x].max_usec);
+	}
+
+	len = strlen(buf);
+	snprintf(buf + len, size - len, " us, %.2f us per channel",
+	    (tick.count == 0 || channels <= 0) ? 0.0 :
+	    (double)tick.sum_usec / (double)tick.count / (double)channels);
+}
+
+/* Write all histograms in a plain text format */
+void
+VOSSProfile :: dump(FILE *fp, int channels)
+{
+	const VOSSHistogram &tick = stat[VOSS_PROF_TICK];
+	int x;
+	int y;
+
+	fprintf(fp, "watchdog tick profile: %llu ticks, %d channels, "
+	    "%.2f us per channel\n", (unsigned long long)tick.count, channels,
+	    (tick.count == 0 || channels <= 0) ? 0.0 :
+	    (double)tick.sum_usec / (double)tick.count / (double)channels);
+
+	for (x = 0; x != VOSS_PROF_MAX; x++) {
+		const VOSSHistogram &st = stat[x];
+
+		fprintf(fp, "%s: count %llu, avg %llu us, p50 %u us, "
+		    "p99 %u us, max %u us\n", voss_profile_phase[x],
+		    (unsigned long long)st.count,
+		    (unsigned long long)(st.count ? st.sum_usec / st.count : 0),
+		    voss_hist_percentile(st, 50), voss_hist_percentile(st, 99),
+		    st.max_usec);
+
+		for (y = 0; y != VOSS_HIST_BUCKETS; y++) {
+			if (st.hist[y] == 0)
+				continue;
+			fprintf(fp, "\t< %u us: %u\n", 1U << y, st.hist[y]);
+		}
+	}
+	fflush(fp);
+}
+
+VOSSProfileScope :: VOSSProfileScope(int _phase)
+{
+	phase = _phase;
+	start = voss_usec();
+}
+
+VOSSProfileScope :: ~VOSSProfileScope()
+{
+	voss_profile.add(phase, start);
+}
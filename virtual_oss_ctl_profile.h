@@ -0,0 +1,86 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_PROFILE_H_
+#define	_VOSS_CTL_PROFILE_H_
+
+#include "virtual_oss_ctl.h"
+
+/* phases of a watchdog tick, see VOSSMainWindow::handle_watchdog() */
+enum {
+	VOSS_PROF_CONSUME,	/* snapshot hand-over and liveness check */
+	VOSS_PROF_MIRROR,	/* mixer state update and reconciler */
+	VOSS_PROF_BIND,		/* strip editors scrolled into view */
+	VOSS_PROF_METERS,	/* meters, poll requests and compressor gain */
+	VOSS_PROF_LOCATOR,	/* audio delay locator */
+	VOSS_PROF_TICK,		/* whole tick */
+	VOSS_PROF_PAINT,	/* meter paint events, outside the tick */
+	VOSS_PROF_MAX,
+};
+
+/*
+ * Time the phases of every watchdog tick with the monotonic clock.
+ * A tick is opened by begin(), each phase is closed by mark(), and
+ * end() records all phases of the tick. Ticks which return early
+ * are not recorded. The profiler is only used by the GUI thread and
+ * has a fixed size, so it can stay enabled on production systems.
+ */
+class VOSSProfile
+{
+public:
+	VOSSProfile();
+
+	void begin(void);
+	void mark(int);
+	void end(void);
+	void add(int, uint64_t);
+
+	void reset(void);
+	void format(char *, size_t, int);
+	void dump(FILE *, int);
+
+	VOSSHistogram stat[VOSS_PROF_MAX];
+
+private:
+	uint64_t tick_start;
+	uint64_t phase_start;
+	uint32_t phase_usec[VOSS_PROF_TICK];
+};
+
+/* Time the enclosing scope into a phase, used for paint events */
+class VOSSProfileScope
+{
+public:
+	VOSSProfileScope(int);
+	~VOSSProfileScope();
+
+private:
+	int phase;
+	uint64_t start;
+};
+
+extern VOSSProfile voss_profile;
+
+#endif		/* _VOSS_CTL_PROFILE_H_ */
@@ -0,0 +1,369 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_io.h"
+#include "virtual_oss_ctl_session.h"
+#include "virtual_oss_ctl_stall.h"
+
+VOSSSessionWorker :: VOSSSessionWorker()
+{
+	job = VOSS_JOB_NONE;
+	done = 0;
+	abandoned = 0;
+	cls = 0;
+	fd = -1;
+	cmd = 0;
+	path = 0;
+	buffer = (char *)malloc(IOCPARM_MAX);
+	taps = 0;
+	result = 0;
+	error = 0;
+}
+
+VOSSSessionWorker :: ~VOSSSessionWorker()
+{
+	free(buffer);
+	free(taps);
+}
+
+void
+VOSSSessionWorker :: run()
+{
+	int what;
+	int ret;
+	int x;
+
+	lock.lock();
+	for (;;) {
+		while (job == VOSS_JOB_NONE && abandoned == 0)
+			wakeup.wait(&lock);
+		if (job == VOSS_JOB_NONE)
+			break;
+		what = job;
+		lock.unlock();
+
+		switch (what) {
+		case VOSS_JOB_IOCTL:
+			ret = voss_io.dispatch(cls, fd, cmd,
+			    (IOCPARM_LEN(cmd) != 0) ? buffer : 0);
+			break;
+		case VOSS_JOB_OPEN:
+			/* make sure the device also responds */
+			ret = voss_io.open(path);
+			if (ret > -1 && voss_io.dispatch(VOSS_IO_READ, ret,
+			    VIRTUAL_OSS_GET_VERSION, &x) != 0) {
+				voss_io.close(ret);
+				ret = -1;
+			}
+			break;
+		default:
+			ret = -1;
+			errno = EINVAL;
+			break;
+		}
+
+		lock.lock();
+		result = ret;
+		error = errno;
+		job = VOSS_JOB_NONE;
+		done = 1;
+		if (abandoned) {
+			/* nobody is waiting for this anymore */
+			if (what == VOSS_JOB_OPEN && ret > -1)
+				voss_io.close(ret);
+			break;
+		}
+		complete.wakeAll();
+	}
+	lock.unlock();
+}
+
+VOSSSession :: VOSSSession(const char *dsp)
+{
+	dsp_name = dsp;
+	dsp_fd = -1;
+	state = VOSS_SESSION_DOWN;
+	failures = 0;
+	backoff = VOSS_SESSION_BACKOFF_MIN;
+	attempts = 0;
+
+	n_stalls = 0;
+	n_trips = 0;
+	n_reconnects = 0;
+	last_stall_ms = 0;
+	last_recovery_ms = 0;
+
+	worker = new VOSSSessionWorker();
+	worker->start();
+
+	retry = new QTimer(this);
+	retry->setSingleShot(true);
+	connect(retry, SIGNAL(timeout()), this, SLOT(handle_retry()));
+
+	dsp_fd = call(VOSS_JOB_OPEN, 0, 0, 0, 0);
+	if (dsp_fd > -1) {
+		state = VOSS_SESSION_UP;
+	} else {
+		dsp_fd = -1;
+		down.start();
+		retry->start(backoff);
+	}
+}
+
+VOSSSession :: ~VOSSSession()
+{
+	if (worker != 0) {
+		worker->lock.lock();
+		worker->abandoned = 1;
+		worker->wakeup.wakeAll();
+		worker->lock.unlock();
+	}
+
+	/* don't hang on exit because of a stalled device */
+	if (worker != 0 && worker->wait(VOSS_SESSION_TIMEOUT))
+		delete worker;
+
+	if (dsp_fd > -1)
+		voss_io.close(dsp_fd);
+}
+
+/*
+ * Run a job on the worker and wait for it, at most
+ * VOSS_SESSION_TIMEOUT ms. Returns the job result and sets errno
+ * like the system call would, or returns -1 with errno set to
+ * ETIMEDOUT.
+ */
+int
+VOSSSession :: call(int job, int cls, unsigned long cmd, void *arg, size_t len)
+{
+	struct virtual_oss_fir_filter *fir = 0;
+	const int fir_kind = (job == VOSS_JOB_IOCTL && len >= sizeof(*fir)) ?
+	    voss_io_fir(cmd) : VOSS_IO_FIR_NONE;
+	double *caller_taps = 0;
+	size_t taps_len = 0;
+	QElapsedTimer elapsed;
+	int result;
+
+	elapsed.start();
+
+	if (worker == 0) {
+		/* a new worker would only queue behind the stuck one */
+		if (!stuck.isNull()) {
+			errno = ETIMEDOUT;
+			return (-1);
+		}
+		worker = new VOSSSessionWorker();
+		worker->start();
+	}
+
+	worker->lock.lock();
+	worker->job = job;
+	worker->done = 0;
+	worker->cls = cls;
+	worker->fd = dsp_fd;
+	worker->cmd = cmd;
+	worker->path = dsp_name;
+	if (len != 0)
+		memcpy(worker->buffer, arg, len);
+
+	if (fir_kind != VOSS_IO_FIR_NONE) {
+		/* the worker gets its own copy of the taps */
+		fir = (struct virtual_oss_fir_filter *)worker->buffer;
+		caller_taps = fir->filter_data;
+		if (caller_taps != 0 && fir->filter_size > 0 &&
+		    fir->filter_size <= VIRTUAL_OSS_FILTER_MAX) {
+			taps_len = fir->filter_size * sizeof(double);
+			worker->taps = (double *)malloc(taps_len);
+			memcpy(worker->taps, caller_taps, taps_len);
+			fir->filter_data = worker->taps;
+		} else {
+			fir->filter_data = 0;
+		}
+	}
+	worker->wakeup.wakeAll();
+
+	while (worker->done == 0) {
+		const qint64 left = VOSS_SESSION_TIMEOUT - elapsed.elapsed();
+
+		if (left <= 0 || !worker->complete.wait(&worker->lock, left))
+			break;
+	}
+
+	if (worker->done == 0) {
+		/* the worker cannot finish while we hold its lock */
+		QObject::connect(worker, SIGNAL(finished()), worker, SLOT(deleteLater()));
+		worker->abandoned = 1;
+		worker->lock.unlock();
+
+		/* let the other threads pass the hung ioctl */
+		voss_io.detach(worker);
+
+		last_stall_ms = elapsed.elapsed();
+		stall();
+		errno = ETIMEDOUT;
+		return (-1);
+	}
+
+	if (len != 0 && (cmd & IOC_OUT))
+		memcpy(arg, worker->buffer, len);
+	if (fir_kind != VOSS_IO_FIR_NONE) {
+		if (cmd & IOC_OUT)
+			((struct virtual_oss_fir_filter *)arg)->filter_data = caller_taps;
+		if (fir_kind == VOSS_IO_FIR_GET && taps_len != 0)
+			memcpy(caller_taps, worker->taps, taps_len);
+		free(worker->taps);
+		worker->taps = 0;
+	}
+	result = worker->result;
+	errno = worker->error;
+	worker->lock.unlock();
+
+	return (result);
+}
+
+int
+VOSSSession :: ioctl(int cls, unsigned long cmd, void *arg)
+{
+	VOSS_STALL_MARK("VOSSSession::ioctl");
+	size_t len = IOCPARM_LEN(cmd);
+	int ret;
+
+	if (state != VOSS_SESSION_UP) {
+		errno = ENXIO;
+		return (-1);
+	}
+
+	if (len > IOCPARM_MAX || arg == 0)
+		len = 0;
+
+	ret = call(VOSS_JOB_IOCTL, cls, cmd, arg, len);
+	if (ret == 0) {
+		failures = 0;
+		return (0);
+	}
+
+	switch (errno) {
+	case EBADF:
+	case EIO:
+	case ENODEV:
+	case ENXIO:
+	case EPIPE:
+		/* the device is in trouble, not just the request */
+		if (++failures >= VOSS_SESSION_FAILURES)
+			trip("too many errors");
+		break;
+	default:
+		break;
+	}
+	return (ret);
+}
+
+/* The device has gone away, as seen by another thread */
+void
+VOSSSession :: fail(void)
+{
+	if (state == VOSS_SESSION_UP)
+		trip("device is not responding");
+}
+
+void
+VOSSSession :: stall(void)
+{
+	n_stalls++;
+
+	warnx("ioctl stalled for more than %u ms", (unsigned)last_stall_ms);
+
+	/*
+	 * The stalled worker deletes itself if it ever returns. Until
+	 * then, calls fail right away and no new worker is started.
+	 */
+	stuck = worker;
+	worker = 0;
+
+	trip("stalled");
+}
+
+/* Open the circuit and start reconnecting */
+void
+VOSSSession :: trip(const char *reason)
+{
+	if (state == VOSS_SESSION_DOWN)
+		return;
+
+	warnx("closing %s: %s", dsp_name, reason);
+
+	state = VOSS_SESSION_DOWN;
+	n_trips++;
+	failures = 0;
+	attempts = 0;
+
+	if (dsp_fd > -1) {
+		voss_io.close(dsp_fd);
+		dsp_fd = -1;
+	}
+
+	down.start();
+	backoff = VOSS_SESSION_BACKOFF_MIN;
+	retry->start(backoff);
+}
+
+void
+VOSSSession :: handle_retry(void)
+{
+	VOSS_STALL_MARK("VOSSSession::handle_retry");
+	int fd;
+
+	attempts++;
+
+	fd = call(VOSS_JOB_OPEN, 0, 0, 0, 0);
+	if (fd < 0) {
+		backoff *= 2;
+		if (backoff > VOSS_SESSION_BACKOFF_MAX)
+			backoff = VOSS_SESSION_BACKOFF_MAX;
+		retry->start(backoff);
+		return;
+	}
+
+	dsp_fd = fd;
+	state = VOSS_SESSION_UP;
+	failures = 0;
+	n_reconnects++;
+	last_recovery_ms = down.elapsed();
+
+	warnx("reconnected to %s after %u ms and %u attempts",
+	    dsp_name, (unsigned)last_recovery_ms, (unsigned)attempts);
+
+	emit reconnected();
+}
+
+void
+VOSSSession :: format(char *buf, size_t size)
+{
+	snprintf(buf, size, "Device session %s, %u stalls, %u disconnects, "
+	    "%u reconnects, last stall %u ms, last recovery %u ms",
+	    (state == VOSS_SESSION_UP) ? "up" : "down",
+	    (unsigned)n_stalls, (unsigned)n_trips, (unsigned)n_reconnects,
+	    (unsigned)last_stall_ms, (unsigned)last_recovery_ms);
+}
@@ -0,0 +1,140 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_SESSION_H_
+#define	_VOSS_CTL_SESSION_H_
+
+#include "virtual_oss_ctl.h"
+
+#define	VOSS_SESSION_TIMEOUT 500	/* ms */
+#define	VOSS_SESSION_FAILURES 3		/* before the circuit opens */
+#define	VOSS_SESSION_BACKOFF_MIN 100	/* ms */
+#define	VOSS_SESSION_BACKOFF_MAX 8000	/* ms */
+
+enum {
+	VOSS_SESSION_UP,
+	VOSS_SESSION_DOWN,		/* circuit is open */
+};
+
+enum {
+	VOSS_JOB_NONE,
+	VOSS_JOB_IOCTL,
+	VOSS_JOB_OPEN,
+};
+
+/*
+ * Thread running one job at a time on behalf of the session. A
+ * worker whose job does not complete in time is abandoned, and
+ * deletes itself if the job ever completes.
+ */
+class VOSSSessionWorker : public QThread
+{
+public:
+	VOSSSessionWorker();
+	~VOSSSessionWorker();
+
+	void run();
+
+	QMutex lock;
+	QWaitCondition wakeup;
+	QWaitCondition complete;
+
+	int job;
+	int done;
+	int abandoned;
+
+	/* job arguments and result */
+	int cls;
+	int fd;
+	unsigned long cmd;
+	const char *path;
+	char *buffer;		/* copy of the ioctl argument */
+	double *taps;		/* copy of the FIR filter taps, if any */
+	int result;
+	int error;		/* errno of the job */
+};
+
+/*
+ * The session owns the control device handle of the GUI thread.
+ * Every ioctl issued by the GUI thread runs on a worker thread, and
+ * the GUI gives up waiting after VOSS_SESSION_TIMEOUT ms, so a hung
+ * device cannot freeze the GUI. A stall, or VOSS_SESSION_FAILURES
+ * consecutive device errors, open the circuit: the handle is closed,
+ * further ioctls fail right away, and the device is re-opened with
+ * exponential backoff. "reconnected" is emitted when the circuit
+ * closes again.
+ *
+ * ioctl arguments, including the taps of FIR filter requests, are
+ * copied, so an abandoned worker never writes to the caller's memory.
+ * While an abandoned worker is still blocked in the device, no new
+ * worker is started and reconnecting is postponed.
+ */
+class VOSSSession : public QObject
+{
+	Q_OBJECT;
+
+public:
+	VOSSSession(const char *);
+	~VOSSSession();
+
+	int fd() const { return (dsp_fd); };
+	int isUp() const { return (state == VOSS_SESSION_UP); };
+	int isCaller() const { return (QThread::currentThread() == thread()); };
+
+	int ioctl(int, unsigned long, void *);
+	void fail(void);
+	void format(char *, size_t);
+
+	uint32_t n_stalls;
+	uint32_t n_trips;
+	uint32_t n_reconnects;
+	uint32_t last_stall_ms;		/* time spent waiting for the stalled ioctl */
+	uint32_t last_recovery_ms;	/* time the circuit was open */
+
+private:
+	int call(int, int, unsigned long, void *, size_t);
+	void stall(void);
+	void trip(const char *);
+
+	const char *dsp_name;
+	int dsp_fd;
+	int state;
+	int failures;
+	int backoff;
+	uint32_t attempts;
+
+	VOSSSessionWorker *worker;
+	QPointer<VOSSSessionWorker> stuck;	/* abandoned, not finished yet */
+	QTimer *retry;
+	QElapsedTimer down;
+
+public slots:
+	void handle_retry(void);
+
+signals:
+	void reconnected(void);
+};
+
+#endif		/* _VOSS_CTL_SESSION_H_ */
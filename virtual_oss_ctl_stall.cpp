@@ -0,0 +1,176 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_profile.h"
+#include "virtual_oss_ctl_stall.h"
+
+VOSSStallDetector *voss_stall;
+
+VOSSStallDetector :: VOSSStallDetector(int threshold_ms)
+{
+	threshold_usec = (uint64_t)threshold_ms * 1000ULL;
+	start_usec = voss_usec();
+	heartbeat.storeRelease(start_usec);
+	depth.storeRelease(0);
+	memset(ring, 0, sizeof(ring));
+	n_events = 0;
+}
+
+VOSSStallDetector :: ~VOSSStallDetector()
+{
+	mtx.lock();
+	requestInterruption();
+	cv.wakeOne();
+	mtx.unlock();
+
+	wait();
+}
+
+/* Heartbeat interval for the GUI thread timer, in ms */
+int
+VOSSStallDetector :: period(void) const
+{
+	const int ms = threshold_usec / 4000;
+
+	return ((ms < 10) ? 10 : ms);
+}
+
+void
+VOSSStallDetector :: beat(void)
+{
+	heartbeat.storeRelease(voss_usec());
+}
+
+void
+VOSSStallDetector :: push(const char *name)
+{
+	const int d = depth.loadAcquire();
+
+	/* deeper markers are counted, but not recorded */
+	if (d < VOSS_STALL_DEPTH)
+		marker[d].storeRelease(name);
+	depth.storeRelease(d + 1);
+}
+
+void
+VOSSStallDetector :: pop(void)
+{
+	depth.storeRelease(depth.loadAcquire() - 1);
+}
+
+/* Describe the markers active right now, outermost first */
+void
+VOSSStallDetector :: where(char *buf, size_t size)
+{
+	const int d = depth.loadAcquire();
+	size_t len;
+	int x;
+
+	if (d <= 0) {
+		/* no handler of ours, likely Qt layout or painting */
+		snprintf(buf, size, "event loop");
+		return;
+	}
+
+	buf[0] = 0;
+	for (x = 0; x != d && x != VOSS_STALL_DEPTH; x++) {
+		len = strlen(buf);
+		snprintf(buf + len, size - len, "%s%s",
+		    x ? " > " : "", marker[x].loadAcquire());
+	}
+}
+
+void
+VOSSStallDetector :: run()
+{
+	VOSSStallEvent ev;
+	uint64_t now;
+	uint64_t last;
+	int stalled = 0;
+
+	mtx.lock();
+	while (!isInterruptionRequested()) {
+		cv.wait(&mtx, period());
+		if (isInterruptionRequested())
+			break;
+
+		now = voss_usec();
+		last = heartbeat.loadAcquire();
+
+		if (now - last > threshold_usec) {
+			if (stalled == 0) {
+				/* sample the markers while still stuck */
+				stalled = 1;
+				ev.start_usec = last - start_usec;
+				where(ev.where, sizeof(ev.where));
+			}
+			continue;
+		}
+		if (stalled == 0)
+			continue;
+		stalled = 0;
+
+		ev.usec = last - start_usec - ev.start_usec;
+		ring[n_events % VOSS_STALL_RING] = ev;
+		n_events++;
+
+		warnx("GUI stalled for %u ms in %s",
+		    (unsigned)(ev.usec / 1000), ev.where);
+	}
+	mtx.unlock();
+}
+
+uint64_t
+VOSSStallDetector :: count(void)
+{
+	QMutexLocker locker(&mtx);
+
+	return (n_events);
+}
+
+/* Write the recorded stalls, oldest first */
+void
+VOSSStallDetector :: dump(FILE *fp)
+{
+	VOSSStallEvent ev;
+	uint64_t n;
+	uint64_t x;
+
+	n = count();
+	fprintf(fp, "GUI stalls above %u ms: %llu\n",
+	    (unsigned)(threshold_usec / 1000), (unsigned long long)n);
+
+	for (x = (n > VOSS_STALL_RING) ? n - VOSS_STALL_RING : 0; x != n; x++) {
+		mtx.lock();
+		ev = ring[x % VOSS_STALL_RING];
+		mtx.unlock();
+
+		fprintf(fp, "\tat %llu.%03u s, %u ms in %s\n",
+		    (unsigned long long)(ev.start_usec / 1000000ULL),
+		    (unsigned)((ev.start_usec / 1000) % 1000),
+		    (unsigned)(ev.usec / 1000), ev.where);
+	}
+	fflush(fp);
+}
@@ -0,0 +1,110 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_STALL_H_
+#define	_VOSS_CTL_STALL_H_
+
+#include "virtual_oss_ctl.h"
+
+#define	VOSS_STALL_THRESHOLD 250	/* ms, default */
+#define	VOSS_STALL_DEPTH 8		/* nested markers */
+#define	VOSS_STALL_RING 64		/* recorded stall events */
+#define	VOSS_STALL_WHERE 128
+
+struct VOSSStallEvent {
+	uint64_t start_usec;	/* since the detector was started */
+	uint64_t usec;
+	char where[VOSS_STALL_WHERE];
+};
+
+/*
+ * Detect stalls of the GUI event loop. The GUI thread calls beat()
+ * from a timer, and a separate thread checks that the heartbeat is
+ * not older than the threshold. When a stall is detected, the stack
+ * of scoped markers entered by the GUI thread tells which handler
+ * was running. Finished stalls are logged and kept in a ring, which
+ * can be dumped later.
+ */
+class VOSSStallDetector : public QThread
+{
+public:
+	VOSSStallDetector(int);
+	~VOSSStallDetector();
+
+	void beat(void);
+	int period(void) const;
+
+	void push(const char *);
+	void pop(void);
+
+	void dump(FILE *);
+	uint64_t count(void);
+
+protected:
+	void run();
+
+private:
+	void where(char *, size_t);
+
+	uint64_t threshold_usec;
+	uint64_t start_usec;
+	QAtomicInteger<quint64> heartbeat;
+
+	/* markers, written by the GUI thread only */
+	QAtomicPointer<const char> marker[VOSS_STALL_DEPTH];
+	QAtomicInt depth;
+
+	QMutex mtx;
+	QWaitCondition cv;
+
+	/* protected by mtx */
+	VOSSStallEvent ring[VOSS_STALL_RING];
+	uint64_t n_events;
+};
+
+/* the running detector, if any */
+extern VOSSStallDetector *voss_stall;
+
+/* Mark the enclosing scope of a GUI thread handler */
+class VOSSStallScope
+{
+public:
+	VOSSStallScope(const char *name) {
+		detector = voss_stall;
+		if (detector != 0)
+			detector->push(name);
+	};
+	~VOSSStallScope() {
+		if (detector != 0)
+			detector->pop();
+	};
+
+private:
+	VOSSStallDetector *detector;
+};
+
+#define	VOSS_STALL_MARK(name) VOSSStallScope voss_stall_scope(name)
+
+#endif		/* _VOSS_CTL_STALL_H_ */
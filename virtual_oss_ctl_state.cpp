@@ -0,0 +1,199 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_state.h"
+
+size_t
+VOSSMixerState :: add(int _type, int _number, int _channel)
+{
+	const size_t x = type.size();
+
+	type.push_back(_type);
+	number.push_back(_number);
+	channel.push_back(_channel);
+	name.push_back(std::string());
+
+	rx_mute.push_back(0);
+	tx_mute.push_back(0);
+	rx_pol.push_back(0);
+	tx_pol.push_back(0);
+	rx_amp.push_back(0);
+	tx_amp.push_back(0);
+	rx_chan.push_back(0);
+	tx_chan.push_back(0);
+	rx_delay.push_back(0);
+	rx_delay_limit.push_back(0);
+	bits.push_back(0);
+
+	limit_enabled.push_back(0);
+	limit_knee.push_back(0);
+	limit_attack.push_back(0);
+	limit_decay.push_back(0);
+	limit_gain.push_back(0);
+	limit_valid.push_back(0);
+
+	return (x);
+}
+
+void
+VOSSMixerState :: clear()
+{
+	*this = VOSSMixerState();
+}
+
+void
+VOSSMixerState :: get_io_info(size_t x, struct virtual_oss_io_info *info) const
+{
+	memset(info, 0, sizeof(*info));
+	info->number = number[x];
+	info->channel = channel[x];
+	strncpy(info->name, name[x].c_str(), sizeof(info->name) - 1);
+	info->bits = bits[x];
+	info->rx_amp = rx_amp[x];
+	info->tx_amp = tx_amp[x];
+	info->rx_chan = rx_chan[x];
+	info->tx_chan = tx_chan[x];
+	info->rx_mute = rx_mute[x];
+	info->tx_mute = tx_mute[x];
+	info->rx_pol = rx_pol[x];
+	info->tx_pol = tx_pol[x];
+	info->rx_delay = rx_delay[x];
+	info->rx_delay_limit = rx_delay_limit[x];
+}
+
+void
+VOSSMixerState :: set_io_info(size_t x, const struct virtual_oss_io_info *info)
+{
+	name[x] = std::string(info->name, strnlen(info->name, sizeof(info->name)));
+	bits[x] = info->bits;
+	rx_amp[x] = info->rx_amp;
+	tx_amp[x] = info->tx_amp;
+	rx_chan[x] = info->rx_chan;
+	tx_chan[x] = info->tx_chan;
+	rx_mute[x] = (info->rx_mute != 0);
+	tx_mute[x] = (info->tx_mute != 0);
+	rx_pol[x] = (info->rx_pol != 0);
+	tx_pol[x] = (info->tx_pol != 0);
+	rx_delay[x] = info->rx_delay;
+	rx_delay_limit[x] = info->rx_delay_limit;
+}
+
+void
+VOSSMixerState :: get_mon_info(size_t x, struct virtual_oss_mon_info *info) const
+{
+	memset(info, 0, sizeof(*info));
+	info->number = number[x];
+	info->bits = bits[x];
+	info->src_chan = rx_chan[x];
+	info->dst_chan = tx_chan[x];
+	info->pol = rx_pol[x];
+	info->mute = rx_mute[x];
+	info->amp = rx_amp[x];
+}
+
+void
+VOSSMixerState :: set_mon_info(size_t x, const struct virtual_oss_mon_info *info)
+{
+	bits[x] = info->bits;
+	rx_chan[x] = info->src_chan;
+	tx_chan[x] = info->dst_chan;
+	rx_pol[x] = (info->pol != 0);
+	rx_mute[x] = (info->mute != 0);
+	rx_amp[x] = info->amp;
+}
+
+/* Return the VOSS_FIELD_XXX flags of the fields which differ */
+int
+VOSSMixerState :: io_info_diff(size_t x, const struct virtual_oss_io_info *info) const
+{
+	int mask = 0;
+
+	if (rx_mute[x] != (info->rx_mute != 0))
+		mask |= VOSS_FIELD_RX_MUTE;
+	if (tx_mute[x] != (info->tx_mute != 0))
+		mask |= VOSS_FIELD_TX_MUTE;
+	if (rx_pol[x] != (info->rx_pol != 0))
+		mask |= VOSS_FIELD_RX_POL;
+	if (tx_pol[x] != (info->tx_pol != 0))
+		mask |= VOSS_FIELD_TX_POL;
+	if (rx_amp[x] != info->rx_amp)
+		mask |= VOSS_FIELD_RX_AMP;
+	if (tx_amp[x] != info->tx_amp)
+		mask |= VOSS_FIELD_TX_AMP;
+	if (rx_chan[x] != info->rx_chan)
+		mask |= VOSS_FIELD_RX_CHAN;
+	if (tx_chan[x] != info->tx_chan)
+		mask |= VOSS_FIELD_TX_CHAN;
+	if (rx_delay[x] != info->rx_delay ||
+	    rx_delay_limit[x] != info->rx_delay_limit)
+		mask |= VOSS_FIELD_RX_DELAY;
+	return (mask);
+}
+
+int
+VOSSMixerState :: mon_info_diff(size_t x, const struct virtual_oss_mon_info *info) const
+{
+	int mask = 0;
+
+	if (rx_mute[x] != (info->mute != 0))
+		mask |= VOSS_FIELD_RX_MUTE;
+	if (rx_pol[x] != (info->pol != 0))
+		mask |= VOSS_FIELD_RX_POL;
+	if (rx_amp[x] != info->amp)
+		mask |= VOSS_FIELD_RX_AMP;
+	if (rx_chan[x] != info->src_chan)
+		mask |= VOSS_FIELD_RX_CHAN;
+	if (tx_chan[x] != info->dst_chan)
+		mask |= VOSS_FIELD_TX_CHAN;
+	return (mask);
+}
+
+void
+VOSSMixerState :: get_limit(size_t x, struct virtual_oss_compressor *limit) const
+{
+	memset(limit, 0, sizeof(*limit));
+	limit->enabled = limit_enabled[x];
+	limit->knee = limit_knee[x];
+	limit->attack = limit_attack[x];
+	limit->decay = limit_decay[x];
+	limit->gain = limit_gain[x];
+}
+
+void
+VOSSMixerState :: set_limit(size_t x, const struct virtual_oss_compressor *limit)
+{
+	limit_enabled[x] = limit->enabled;
+	limit_knee[x] = limit->knee;
+	limit_attack[x] = limit->attack;
+	limit_decay[x] = limit->decay;
+	limit_gain[x] = limit->gain;
+	limit_valid[x] = 1;
+}
+
+void
+VOSSMixerState :: invalidate_limits()
+{
+	std::fill(limit_valid.begin(), limit_valid.end(), 0);
+}
@@ -0,0 +1,107 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_STATE_H_
+#define	_VOSS_CTL_STATE_H_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "virtual_oss/virtual_oss.h"
+
+/* configuration fields, as reported by the diff functions */
+enum {
+	VOSS_FIELD_RX_MUTE = 1 << 0,
+	VOSS_FIELD_TX_MUTE = 1 << 1,
+	VOSS_FIELD_RX_POL = 1 << 2,
+	VOSS_FIELD_TX_POL = 1 << 3,
+	VOSS_FIELD_RX_AMP = 1 << 4,
+	VOSS_FIELD_TX_AMP = 1 << 5,
+	VOSS_FIELD_RX_CHAN = 1 << 6,
+	VOSS_FIELD_TX_CHAN = 1 << 7,
+	VOSS_FIELD_RX_DELAY = 1 << 8,
+	VOSS_FIELD_ALL = (1 << 9) - 1,
+};
+
+/* fields which are drawn in the connection diagram */
+#define	VOSS_FIELD_ROUTING (VOSS_FIELD_RX_MUTE | VOSS_FIELD_TX_MUTE | \
+    VOSS_FIELD_RX_CHAN | VOSS_FIELD_TX_CHAN)
+
+/*
+ * Plain data mixer state model. Every field is stored in its own
+ * contiguous array indexed by controller slot, so that whole mixer
+ * scans, like writing back after a reconnect or reconciling polled
+ * changes, don't need to touch any widgets.
+ */
+class VOSSMixerState
+{
+public:
+	size_t size() const { return (type.size()); };
+	size_t add(int, int, int);
+	void clear();
+
+	void get_io_info(size_t, struct virtual_oss_io_info *) const;
+	void set_io_info(size_t, const struct virtual_oss_io_info *);
+	void get_mon_info(size_t, struct virtual_oss_mon_info *) const;
+	void set_mon_info(size_t, const struct virtual_oss_mon_info *);
+	int io_info_diff(size_t, const struct virtual_oss_io_info *) const;
+	int mon_info_diff(size_t, const struct virtual_oss_mon_info *) const;
+	void get_limit(size_t, struct virtual_oss_compressor *) const;
+	void set_limit(size_t, const struct virtual_oss_compressor *);
+	void invalidate_limits();
+
+	/* identity */
+	std::vector<int> type;
+	std::vector<int> number;
+	std::vector<int> channel;
+	std::vector<std::string> name;
+
+	/* configuration, for monitors only the RX fields are used */
+	std::vector<int8_t> rx_mute;
+	std::vector<int8_t> tx_mute;
+	std::vector<int8_t> rx_pol;
+	std::vector<int8_t> tx_pol;
+	std::vector<int> rx_amp;
+	std::vector<int> tx_amp;
+	std::vector<int> rx_chan;	/* source channel for monitors */
+	std::vector<int> tx_chan;	/* destination channel for monitors */
+	std::vector<int> rx_delay;
+	std::vector<int> rx_delay_limit;
+	std::vector<int> bits;
+
+	/* compressor */
+	std::vector<int> limit_enabled;
+	std::vector<int> limit_knee;
+	std::vector<int> limit_attack;
+	std::vector<int> limit_decay;
+	std::vector<int> limit_gain;
+	std::vector<int8_t> limit_valid;	/* matches the device */
+};
+
+#endif		/* _VOSS_CTL_STATE_H_ */
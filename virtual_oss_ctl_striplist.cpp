@@ -0,0 +1,261 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_mainwindow.h"
+#include "virtual_oss_ctl_stall.h"
+#include "virtual_oss_ctl_striplist.h"
+
+#include <algorithm>
+
+VOSSStripList :: VOSSStripList(VOSSMainWindow *_parent)
+{
+	int x;
+
+	parent = _parent;
+
+	for (x = 0; x != VOSS_TYPE_MAX; x++)
+		row_height[x] = 0;
+
+	row_width = 0;
+	bound_first = 0;
+	bound_last = 0;
+	bound_holes = 0;
+	n_editors = 0;
+
+	relayout();
+}
+
+VOSSStripList :: ~VOSSStripList()
+{
+	reset();
+}
+
+/*
+ * Unbind all editors. This must be done before the channel records
+ * are freed, because bound editors refer to them.
+ */
+void
+VOSSStripList :: reset(void)
+{
+	int x;
+
+	for (x = bound_first; x != bound_last; x++)
+		release(x);
+
+	bound_first = 0;
+	bound_last = 0;
+}
+
+/*
+ * Create a prototype editor for the given type, to find out how much
+ * room its row needs. The prototype is kept in the free pool.
+ */
+int
+VOSSStripList :: measure(int type)
+{
+	VOSSController *pc;
+	QSize sz;
+
+	if (row_height[type] != 0)
+		return (row_height[type]);
+
+	pc = new VOSSController(parent, type);
+	pc->setParent(this);
+	pc->hide();
+	n_editors++;
+
+	sz = pc->sizeHint();
+	if (sz.width() > row_width)
+		row_width = sz.width();
+	row_height[type] = sz.height() + VSL_SPACING;
+
+	pool[type].append(pc);
+
+	return (row_height[type]);
+}
+
+/*
+ * Compute the row order and row positions. Editors which are already
+ * bound keep their channel and are only moved, so that this can be
+ * used when channels are added or removed.
+ */
+void
+VOSSStripList :: relayout(void)
+{
+	VOSSController *pc;
+	int x;
+	int y;
+
+	parent->slot_order(order);
+
+	row_top.resize(order.size() + 1);
+
+	for (x = y = 0; x != order.size(); x++) {
+		row_top[x] = y;
+		y += measure(parent->vb[order[x]]->type);
+	}
+	row_top[x] = y;
+
+	bound_first = order.size();
+	bound_last = 0;
+
+	for (x = 0; x != order.size(); x++) {
+		pc = parent->vb[order[x]]->view;
+		if (pc == 0)
+			continue;
+		pc->setGeometry(0, row_top[x], width(),
+		    row_top[x + 1] - row_top[x] - VSL_SPACING);
+		if (x < bound_first)
+			bound_first = x;
+		bound_last = x + 1;
+	}
+	if (bound_first > bound_last)
+		bound_first = bound_last = 0;
+
+	/* inserted rows inside the range are bound by the next sync() */
+	bound_holes = 1;
+
+	setMinimumSize(row_width, y);
+	updateGeometry();
+}
+
+QSize
+VOSSStripList :: sizeHint() const
+{
+	return (QSize(row_width, row_top.last()));
+}
+
+int
+VOSSStripList :: row_at(int y) const
+{
+	const int n = row_top.size() - 1;
+	int x;
+
+	if (n <= 0)
+		return (0);
+
+	x = std::upper_bound(row_top.begin(), row_top.end() - 1, y) - row_top.begin() - 1;
+	if (x < 0)
+		x = 0;
+	else if (x >= n)
+		x = n - 1;
+	return (x);
+}
+
+void
+VOSSStripList :: acquire(int x)
+{
+	VOSSChannel *ch = parent->vb[order[x]];
+	VOSSController *pc;
+
+	if (ch->view != 0)
+		return;
+
+	if (pool[ch->type].isEmpty()) {
+		pc = new VOSSController(parent, ch->type);
+		pc->setParent(this);
+		n_editors++;
+	} else {
+		pc = pool[ch->type].takeLast();
+	}
+
+	pc->bind(ch);
+	pc->setGeometry(0, row_top[x], width(),
+	    row_top[x + 1] - row_top[x] - VSL_SPACING);
+	pc->show();
+}
+
+void
+VOSSStripList :: release(int x)
+{
+	release_channel(parent->vb[order[x]]);
+}
+
+void
+VOSSStripList :: release_channel(VOSSChannel *ch)
+{
+	VOSSController *pc = ch->view;
+
+	if (pc == 0)
+		return;
+
+	pc->unbind();
+	pc->hide();
+	pool[pc->type].append(pc);
+}
+
+void
+VOSSStripList :: sync(void)
+{
+	const QRect r = parent->visibleRect(this);
+	const int n = row_top.size() - 1;
+	int first;
+	int last;
+	int x;
+
+	if (r.isEmpty() || n <= 0) {
+		first = last = 0;
+	} else {
+		/* keep half a page bound on either side */
+		first = row_at(r.top() - r.height() / 2);
+		last = row_at(r.bottom() + r.height() / 2) + 1;
+	}
+
+	if (first == bound_first && last == bound_last && bound_holes == 0)
+		return;
+
+	for (x = bound_first; x != bound_last; x++) {
+		if (x < first || x >= last)
+			release(x);
+	}
+	for (x = first; x != last; x++)
+		acquire(x);
+
+	bound_first = first;
+	bound_last = last;
+	bound_holes = 0;
+}
+
+void
+VOSSStripList :: resizeEvent(QResizeEvent *event)
+{
+	VOSSController *pc;
+	int x;
+
+	for (x = bound_first; x != bound_last; x++) {
+		pc = parent->vb[order[x]]->view;
+		if (pc != 0)
+			pc->resize(width(), pc->height());
+	}
+	sync();
+}
+
+void
+VOSSStripList :: handle_scroll()
+{
+	VOSS_STALL_MARK("VOSSStripList::handle_scroll");
+
+	sync();
+}
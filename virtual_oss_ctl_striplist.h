@@ -0,0 +1,90 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_STRIPLIST_H_
+#define	_VOSS_CTL_STRIPLIST_H_
+
+#include "virtual_oss_ctl.h"
+
+#define	VSL_SPACING 6
+
+/*
+ * The strip list shows one editor row per channel record, but only
+ * creates editors for the rows inside the viewport, plus half a page
+ * above and below. Editors that scroll out of view are unbound and
+ * kept in a free pool per channel type, so that scrolling through a
+ * large mixer only rebinds existing widgets.
+ */
+class VOSSStripList : public QWidget
+{
+	Q_OBJECT;
+
+public:
+	VOSSStripList(VOSSMainWindow *);
+	~VOSSStripList();
+
+	void relayout(void);
+	void reset(void);
+	void sync(void);
+	void release_channel(VOSSChannel *);
+
+	QSize sizeHint() const;
+
+	VOSSMainWindow *parent;
+
+	/* slot shown in each row, sorted by type, number and channel */
+	QVector<int> order;
+
+	/* top of each row, the last entry is the total height */
+	QVector<int> row_top;
+
+	/* editor row height for every channel type, 0 if unknown */
+	int row_height[VOSS_TYPE_MAX];
+	int row_width;
+
+	/* unbound editors, per channel type */
+	QVector<VOSSController *> pool[VOSS_TYPE_MAX];
+
+	/* currently bound row range */
+	int bound_first;
+	int bound_last;
+	int bound_holes;	/* rows in the range may lack an editor */
+
+	int n_editors;
+
+protected:
+	void resizeEvent(QResizeEvent *);
+
+private:
+	int measure(int);
+	int row_at(int) const;
+	void acquire(int);
+	void release(int);
+
+public slots:
+	void handle_scroll();
+};
+
+#endif		/* _VOSS_CTL_STRIPLIST_H_ */
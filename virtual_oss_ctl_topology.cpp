@@ -0,0 +1,534 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_equalizer.h"
+#include "virtual_oss_ctl_io.h"
+#include "virtual_oss_ctl_topology.h"
+
+#include <sys/stat.h>
+#include <stdlib.h>
+
+#include <algorithm>
+
+static bool
+voss_topology_less(const VOSSTopologyEntry &a, const VOSSTopologyEntry &b)
+{
+	if (a.type != b.type)
+		return (a.type < b.type);
+	if (a.number != b.number)
+		return (a.number < b.number);
+	return (a.channel < b.channel);
+}
+
+VOSSTopologyProbe :: VOSSTopologyProbe(int _fd, int _type)
+{
+	fd = _fd;
+	type = _type;
+	n_ioctls = 0;
+}
+
+void
+VOSSTopologyProbe :: run()
+{
+	VOSSTopology::enumerate(fd, type, 0, 0, result, n_ioctls);
+}
+
+VOSSTopology :: VOSSTopology()
+{
+	int x;
+
+	for (x = 0; x != VOSS_TYPE_MAX; x++)
+		count[x] = 0;
+
+	sample_rate = 0;
+	cached = 0;
+	discover_usec = 0;
+	n_ioctls = 0;
+}
+
+/*
+ * Append all channels of the given type, starting at the given
+ * number and channel, until the device reports no more channels.
+ * Returns the number of channels found.
+ */
+int
+VOSSTopology :: enumerate(int fd, int type, int num, int chan,
+    QVector<VOSSTopologyEntry> &result, uint32_t &n)
+{
+	VOSSTopologyEntry e;
+	int found = 0;
+
+	switch (type) {
+	case VOSS_TYPE_DEVICE:
+	case VOSS_TYPE_LOOPBACK:
+	case VOSS_TYPE_MAIN_OUTPUT:
+	case VOSS_TYPE_MAIN_INPUT:
+		/* the number of channels is not known in advance */
+		for (; ; num++, chan = 0) {
+			const int first = chan;
+
+			for (; ; chan++) {
+				memset(&e, 0, sizeof(e));
+				e.type = type;
+				e.number = num;
+				e.channel = chan;
+				if (probe(fd, e, n) != 0)
+					break;
+				result.append(e);
+				found++;
+			}
+			if (chan == first || type == VOSS_TYPE_MAIN_OUTPUT ||
+			    type == VOSS_TYPE_MAIN_INPUT)
+				break;
+		}
+		break;
+	default:
+		/* monitors have a single channel */
+		for (; ; num++) {
+			memset(&e, 0, sizeof(e));
+			e.type = type;
+			e.number = num;
+			if (probe(fd, e, n) != 0)
+				break;
+			result.append(e);
+			found++;
+		}
+		break;
+	}
+	return (found);
+}
+
+/*
+ * Read the configuration of a single channel, including the sizes
+ * of its FIR filters. Returns non-zero when the channel does not
+ * exist.
+ */
+int
+VOSSTopology :: probe(int fd, VOSSTopologyEntry &e, uint32_t &n)
+{
+	int error;
+
+	error = probe_info(fd, VOSS_IO_READ, e, n);
+	if (error)
+		return (error);
+
+	switch (e.type) {
+	case VOSS_TYPE_DEVICE:
+	case VOSS_TYPE_LOOPBACK:
+		e.rx_eq_size = VOSSEqualizer::probe(fd,
+		    e.type | VOSS_TYPE_RX, e.number, e.channel);
+		e.tx_eq_size = VOSSEqualizer::probe(fd,
+		    e.type | VOSS_TYPE_TX, e.number, e.channel);
+		n += 2;
+		break;
+	default:
+		break;
+	}
+	return (0);
+}
+
+/*
+ * Read the configuration of a single channel with a single ioctl of
+ * the given scheduler class. Returns non-zero when the channel does
+ * not exist.
+ */
+int
+VOSSTopology :: probe_info(int fd, int cls, VOSSTopologyEntry &e, uint32_t &n)
+{
+	struct virtual_oss_master_peak master_peak;
+	int error;
+
+	switch (e.type) {
+	case VOSS_TYPE_DEVICE:
+	case VOSS_TYPE_LOOPBACK:
+		memset(&e.io_info, 0, sizeof(e.io_info));
+		e.io_info.number = e.number;
+		e.io_info.channel = e.channel;
+		error = voss_io.ioctl(cls, fd, (e.type == VOSS_TYPE_DEVICE) ?
+		    VIRTUAL_OSS_GET_DEV_INFO : VIRTUAL_OSS_GET_LOOP_INFO, &e.io_info);
+		n++;
+		break;
+	case VOSS_TYPE_INPUT_MON:
+	case VOSS_TYPE_OUTPUT_MON:
+	case VOSS_TYPE_LOCAL_MON:
+		memset(&e.mon_info, 0, sizeof(e.mon_info));
+		e.mon_info.number = e.number;
+		if (e.channel != 0) {
+			error = EINVAL;
+			break;
+		}
+		error = voss_io.ioctl(cls, fd, (e.type == VOSS_TYPE_INPUT_MON) ?
+		    VIRTUAL_OSS_GET_INPUT_MON_INFO : (e.type == VOSS_TYPE_OUTPUT_MON) ?
+		    VIRTUAL_OSS_GET_OUTPUT_MON_INFO : VIRTUAL_OSS_GET_LOCAL_MON_INFO,
+		    &e.mon_info);
+		n++;
+		break;
+	case VOSS_TYPE_MAIN_OUTPUT:
+	case VOSS_TYPE_MAIN_INPUT:
+		/* master channels have no info ioctl, probe the peak */
+		memset(&master_peak, 0, sizeof(master_peak));
+		master_peak.channel = e.channel;
+		if (e.number != 0) {
+			error = EINVAL;
+			break;
+		}
+		error = voss_io.ioctl(cls, fd, (e.type == VOSS_TYPE_MAIN_OUTPUT) ?
+		    VIRTUAL_OSS_GET_OUTPUT_PEAK : VIRTUAL_OSS_GET_INPUT_PEAK,
+		    &master_peak);
+		n++;
+		break;
+	default:
+		error = EINVAL;
+		break;
+	}
+	return (error);
+}
+
+/*
+ * Probe all channels. Returns non-zero if the device did not answer,
+ * in which case the topology is incomplete.
+ */
+int
+VOSSTopology :: discover(int fd)
+{
+	VOSSTopologyProbe *probe[VOSS_TYPE_MAX];
+	QElapsedTimer timer;
+	int x;
+
+	timer.start();
+
+	entries.clear();
+	cached = 0;
+	sample_rate = 0;
+	n_ioctls = 0;
+
+	if (fd < 0)
+		return (EBADF);
+
+	n_ioctls++;
+	if (voss_io.ioctl(VOSS_IO_READ, fd, VIRTUAL_OSS_GET_SAMPLE_RATE,
+	    &sample_rate) != 0)
+		return (errno);
+
+	for (x = 0; x != VOSS_TYPE_MAX; x++) {
+		probe[x] = new VOSSTopologyProbe(fd, x);
+		probe[x]->start();
+	}
+	for (x = 0; x != VOSS_TYPE_MAX; x++) {
+		probe[x]->wait();
+		count[x] = probe[x]->result.size();
+		entries += probe[x]->result;
+		n_ioctls += probe[x]->n_ioctls;
+		delete probe[x];
+	}
+
+	discover_usec = timer.nsecsElapsed() / 1000;
+	return (0);
+}
+
+/*
+ * Compute the cache file name for a control device. The device path
+ * is flattened into the file name.
+ */
+int
+VOSSTopology :: cache_path(const char *dsp, char *buf, size_t size)
+{
+	const char *base = getenv("XDG_CACHE_HOME");
+	const char *home = getenv("HOME");
+	size_t len;
+	size_t x;
+
+	if (dsp == 0)
+		return (EINVAL);
+
+	if (base != 0 && base[0] != 0)
+		len = snprintf(buf, size, "%s/virtual_oss_ctl", base);
+	else if (home != 0 && home[0] != 0)
+		len = snprintf(buf, size, "%s/.cache/virtual_oss_ctl", home);
+	else
+		return (ENOENT);
+
+	if (len >= size)
+		return (ENAMETOOLONG);
+
+	/* the parent directory is usually present, ignore errors */
+	mkdir(buf, 0700);
+
+	x = len;
+	len += snprintf(buf + len, size - len, "/%s.topology", dsp);
+	if (len >= size)
+		return (ENAMETOOLONG);
+
+	for (x++; buf[x] != 0; x++) {
+		if (buf[x] == '/')
+			buf[x] = '_';
+	}
+	return (0);
+}
+
+int
+VOSSTopology :: load(const char *dsp)
+{
+	struct VOSSTopologyCache hdr;
+	char path[256];
+	FILE *fp;
+	int x;
+
+	if (cache_path(dsp, path, sizeof(path)) != 0)
+		return (0);
+
+	fp = fopen(path, "r");
+	if (fp == 0)
+		return (0);
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    memcmp(hdr.magic, VOSS_TOPOLOGY_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.entry_size != sizeof(VOSSTopologyEntry) ||
+	    hdr.n_entries > 65536) {
+		fclose(fp);
+		return (0);
+	}
+
+	entries.resize(hdr.n_entries);
+
+	if (hdr.n_entries != 0 &&
+	    fread(entries.data(), sizeof(VOSSTopologyEntry),
+	    hdr.n_entries, fp) != hdr.n_entries) {
+		entries.clear();
+		fclose(fp);
+		return (0);
+	}
+	fclose(fp);
+
+	for (x = 0; x != VOSS_TYPE_MAX; x++)
+		count[x] = hdr.count[x];
+	sample_rate = hdr.sample_rate;
+	cached = 1;
+	discover_usec = 0;
+	n_ioctls = 0;
+
+	return (1);
+}
+
+int
+VOSSTopology :: save(const char *dsp) const
+{
+	QVector<VOSSTopologyEntry> list;
+	struct VOSSTopologyCache hdr;
+	char path[256];
+	char temp[256 + 4];
+	FILE *fp;
+	int x;
+
+	if (cache_path(dsp, path, sizeof(path)) != 0)
+		return (0);
+
+	/* removed channels are skipped, and the slot order is restored */
+	for (x = 0; x != entries.size(); x++) {
+		if (entries[x].type >= 0)
+			list.append(entries[x]);
+	}
+	std::stable_sort(list.begin(), list.end(), voss_topology_less);
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, VOSS_TOPOLOGY_MAGIC, sizeof(hdr.magic));
+	hdr.entry_size = sizeof(VOSSTopologyEntry);
+	hdr.n_entries = list.size();
+	hdr.sample_rate = sample_rate;
+	for (x = 0; x != VOSS_TYPE_MAX; x++)
+		hdr.count[x] = count[x];
+
+	/* write a new file and rename it, so readers never see a partial cache */
+	snprintf(temp, sizeof(temp), "%s.new", path);
+
+	fp = fopen(temp, "w");
+	if (fp == 0)
+		return (0);
+
+	if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    (hdr.n_entries != 0 &&
+	     fwrite(list.constData(), sizeof(VOSSTopologyEntry),
+	     hdr.n_entries, fp) != hdr.n_entries)) {
+		fclose(fp);
+		unlink(temp);
+		return (0);
+	}
+	if (fclose(fp) != 0 || rename(temp, path) != 0) {
+		unlink(temp);
+		return (0);
+	}
+	return (1);
+}
+
+/* Check if both topologies have the same channels in the same order */
+int
+VOSSTopology :: same_layout(const VOSSTopology &other) const
+{
+	int x;
+
+	if (entries.size() != other.entries.size())
+		return (0);
+
+	for (x = 0; x != entries.size(); x++) {
+		if (entries[x].type != other.entries[x].type ||
+		    entries[x].number != other.entries[x].number ||
+		    entries[x].channel != other.entries[x].channel)
+			return (0);
+	}
+	return (1);
+}
+
+void
+VOSSTopologyVerify :: run()
+{
+	const int fd = voss_io.open(dsp);
+
+	if (fd < 0)
+		return;
+	failed = (result.discover(fd) != 0);
+	voss_io.close(fd);
+}
+
+VOSSTopologyHotplug :: VOSSTopologyHotplug(const char *_dsp,
+    const QVector<VOSSTopologyEntry> &_known)
+{
+	dsp = _dsp;
+	fd = -1;
+	failed = 0;
+	n_ioctls = 0;
+	known = _known;
+
+	std::sort(known.begin(), known.end(), voss_topology_less);
+}
+
+/*
+ * Check if a known channel still exists. Returns zero if it does,
+ * one if it is gone and -1 if the device did not answer.
+ */
+int
+VOSSTopologyHotplug :: exists(const VOSSTopologyEntry &k)
+{
+	VOSSTopologyEntry e = k;
+
+	if (VOSSTopology::probe_info(fd, VOSS_IO_POLL, e, n_ioctls) == 0)
+		return (0);
+	if (errno == EINVAL)
+		return (1);
+	failed = 1;
+	return (-1);
+}
+
+/*
+ * Check the known channels "first" to "last" - 1, which belong to
+ * the same device or loopback, or to the same master or monitor type.
+ */
+void
+VOSSTopologyHotplug :: scan(int first, int last)
+{
+	const VOSSTopologyEntry &k = known[last - 1];
+	const int is_last = (last == known.size() || known[last].type != k.type);
+	VOSSTopologyEntry e;
+	int x;
+
+	switch (exists(k)) {
+	case 0:
+		break;
+	case 1:
+		/* walk backwards until a channel which still exists */
+		for (x = last - 2; x >= first; x--) {
+			const int error = exists(known[x]);
+
+			if (error < 0)
+				return;
+			if (error == 0)
+				break;
+		}
+		for (x++; x != last; x++)
+			removed.append(known[x]);
+		return;
+	default:
+		return;
+	}
+
+	switch (k.type) {
+	case VOSS_TYPE_DEVICE:
+	case VOSS_TYPE_LOOPBACK:
+		/* channels added to this device or loopback */
+		for (e = k; ; ) {
+			e.channel++;
+			if (VOSSTopology::probe(fd, e, n_ioctls) != 0)
+				break;
+			added.append(e);
+		}
+		if (is_last)
+			VOSSTopology::enumerate(fd, k.type, k.number + 1, 0, added, n_ioctls);
+		break;
+	case VOSS_TYPE_MAIN_OUTPUT:
+	case VOSS_TYPE_MAIN_INPUT:
+		VOSSTopology::enumerate(fd, k.type, 0, k.channel + 1, added, n_ioctls);
+		break;
+	default:
+		VOSSTopology::enumerate(fd, k.type, k.number + 1, 0, added, n_ioctls);
+		break;
+	}
+}
+
+void
+VOSSTopologyHotplug :: run()
+{
+	int seen[VOSS_TYPE_MAX];
+	int type;
+	int x;
+	int y;
+
+	fd = voss_io.open(dsp);
+	if (fd < 0) {
+		failed = 1;
+		return;
+	}
+
+	for (type = 0; type != VOSS_TYPE_MAX; type++)
+		seen[type] = 0;
+
+	for (x = 0; x != known.size() && failed == 0; x = y) {
+		type = known[x].type;
+		seen[type] = 1;
+
+		/* devices and loopbacks are checked one by one */
+		for (y = x + 1; y != known.size() && known[y].type == type; y++) {
+			if ((type == VOSS_TYPE_DEVICE || type == VOSS_TYPE_LOOPBACK) &&
+			    known[y].number != known[x].number)
+				break;
+		}
+		scan(x, y);
+	}
+
+	for (type = 0; type != VOSS_TYPE_MAX && failed == 0; type++) {
+		if (seen[type] == 0)
+			VOSSTopology::enumerate(fd, type, 0, 0, added, n_ioctls);
+	}
+
+	voss_io.close(fd);
+}
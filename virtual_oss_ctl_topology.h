@@ -0,0 +1,151 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_TOPOLOGY_H_
+#define	_VOSS_CTL_TOPOLOGY_H_
+
+#include "virtual_oss_ctl.h"
+
+/* Everything known about a single channel after discovery */
+struct VOSSTopologyEntry {
+	int type;		/* -1 if the channel was removed */
+	int number;
+	int channel;
+	int rx_eq_size;		/* FIR filter sizes, devices and loopbacks only */
+	int tx_eq_size;
+	union {
+		struct virtual_oss_io_info io_info;
+		struct virtual_oss_mon_info mon_info;
+	};
+};
+
+/*
+ * Probes all channels of a single type, using the info ioctls which
+ * also return the channel configuration.
+ */
+class VOSSTopologyProbe : public QThread
+{
+public:
+	VOSSTopologyProbe(int, int);
+
+	void run();
+
+	int fd;
+	int type;
+	uint32_t n_ioctls;
+
+	QVector<VOSSTopologyEntry> result;
+};
+
+/* On-disk cache header, followed by the entries */
+struct VOSSTopologyCache {
+	char magic[8];
+	uint32_t entry_size;
+	uint32_t n_entries;
+	int32_t sample_rate;
+	int32_t count[VOSS_TYPE_MAX];
+};
+
+#define	VOSS_TOPOLOGY_MAGIC "VOSSTOP1"
+
+/*
+ * Complete channel topology of a virtual_oss instance. Every channel
+ * type is probed by its own worker thread, and the results are
+ * merged in type order, which is also the controller slot order.
+ */
+class VOSSTopology
+{
+public:
+	VOSSTopology();
+
+	int discover(int);
+
+	int load(const char *);
+	int save(const char *) const;
+	int same_layout(const VOSSTopology &) const;
+
+	static int probe(int, VOSSTopologyEntry &, uint32_t &);
+	static int probe_info(int, int, VOSSTopologyEntry &, uint32_t &);
+	static int enumerate(int, int, int, int, QVector<VOSSTopologyEntry> &, uint32_t &);
+	static int cache_path(const char *, char *, size_t);
+
+	QVector<VOSSTopologyEntry> entries;
+
+	int count[VOSS_TYPE_MAX];	/* channels per type */
+	int sample_rate;
+	int cached;			/* entries were loaded from disk */
+	uint32_t discover_usec;
+	uint32_t n_ioctls;
+};
+
+/*
+ * Runs a complete discovery in the background, on its own handle of
+ * the control device. This checks a topology loaded from the cache
+ * against the live device, or finds the channels when there is no
+ * cache. The result is only valid if "failed" is zero.
+ */
+class VOSSTopologyVerify : public QThread
+{
+public:
+	VOSSTopologyVerify(const char *_dsp) : dsp(_dsp), failed(1) {};
+
+	void run();
+
+	const char *dsp;
+	int failed;
+	VOSSTopology result;
+};
+
+/*
+ * Looks for channels which were added or removed since the last
+ * discovery, in the background and on its own handle of the control
+ * device. The last known channel of each
+ * device, loopback and channel type is checked with its info ioctl
+ * only, and the channels following it are probed. The result is
+ * only valid if "failed" is zero, because a device which does not
+ * answer would look like all its channels were removed.
+ */
+class VOSSTopologyHotplug : public QThread
+{
+public:
+	VOSSTopologyHotplug(const char *, const QVector<VOSSTopologyEntry> &);
+
+	void run();
+
+	const char *dsp;
+	int fd;
+	int failed;
+	uint32_t n_ioctls;
+
+	QVector<VOSSTopologyEntry> known;
+	QVector<VOSSTopologyEntry> added;
+	QVector<VOSSTopologyEntry> removed;
+
+private:
+	int exists(const VOSSTopologyEntry &);
+	void scan(int, int);
+};
+
+#endif		/* _VOSS_CTL_TOPOLOGY_H_ */
@@ -0,0 +1,317 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include "virtual_oss_ctl_io.h"
+#include "virtual_oss_ctl_trace.h"
+
+/* Copy a request argument, with the FIR filter pointer reduced to a flag */
+static void
+voss_trace_copy(unsigned long cmd, char *dst, const void *src, size_t len)
+{
+	struct virtual_oss_fir_filter *fir;
+
+	if (len == 0 || src == 0)
+		return;
+
+	memcpy(dst, src, len);
+
+	if (voss_io_fir(cmd) != VOSS_IO_FIR_NONE && len >= sizeof(*fir)) {
+		fir = (struct virtual_oss_fir_filter *)dst;
+		fir->filter_data = (fir->filter_data != 0) ? (double *)1 : 0;
+	}
+}
+
+static size_t
+voss_trace_len(unsigned long cmd, const void *arg)
+{
+	const size_t len = IOCPARM_LEN(cmd);
+
+	if (arg == 0 || len > IOCPARM_MAX)
+		return (0);
+	return (len);
+}
+
+VOSSTraceRecorder :: VOSSTraceRecorder(VOSSBackend *_inner, FILE *_fp)
+{
+	VOSSTraceHeader hdr;
+
+	inner = _inner;
+	fp = _fp;
+	start_usec = voss_usec();
+
+	memset(&hdr, 0, sizeof(hdr));
+	strlcpy(hdr.magic, VOSS_TRACE_MAGIC, sizeof(hdr.magic));
+	hdr.version = VOSS_TRACE_VERSION;
+	hdr.record_size = sizeof(VOSSTraceRecord);
+	fwrite(&hdr, sizeof(hdr), 1, fp);
+}
+
+VOSSTraceRecorder :: ~VOSSTraceRecorder()
+{
+	fclose(fp);
+}
+
+/* Wrap "inner" with a recorder writing to "path", NULL on error */
+VOSSTraceRecorder *
+VOSSTraceRecorder :: create(VOSSBackend *inner, const char *path)
+{
+	FILE *fp = fopen(path, "w");
+
+	if (fp == NULL)
+		return (0);
+	return (new VOSSTraceRecorder(inner, fp));
+}
+
+int
+VOSSTraceRecorder :: open(const char *path)
+{
+	return (inner->open(path));
+}
+
+void
+VOSSTraceRecorder :: close(int fd)
+{
+	inner->close(fd);
+	flush();
+}
+
+void
+VOSSTraceRecorder :: flush(void)
+{
+	QMutexLocker locker(&lock);
+
+	fflush(fp);
+}
+
+int
+VOSSTraceRecorder :: ioctl(int fd, unsigned long cmd, void *arg)
+{
+	const size_t len = voss_trace_len(cmd, arg);
+	const struct virtual_oss_fir_filter *fir;
+	VOSSTraceRecord rec;
+	char input[IOCPARM_MAX];
+	char output[IOCPARM_MAX];
+	uint64_t start;
+	int ret;
+	int error;
+
+	voss_trace_copy(cmd, input, arg, len);
+
+	start = voss_usec();
+	ret = inner->ioctl(fd, cmd, arg);
+	error = errno;
+
+	memset(&rec, 0, sizeof(rec));
+	rec.usec = start - start_usec;
+	rec.dur_usec = voss_usec() - start;
+	rec.cmd = cmd;
+	rec.result = ret;
+	rec.error = (ret != 0) ? error : 0;
+	rec.len = len;
+
+	voss_trace_copy(cmd, output, arg, len);
+	if (len == 0 || memcmp(input, output, len) == 0)
+		rec.flags |= VOSS_TRACE_SAME;
+
+	fir = (const struct virtual_oss_fir_filter *)arg;
+	if (ret == 0 && voss_io_fir(cmd) == VOSS_IO_FIR_GET &&
+	    fir->filter_data != 0 && fir->filter_size > 0 &&
+	    fir->filter_size <= VIRTUAL_OSS_FILTER_MAX)
+		rec.extra = fir->filter_size * sizeof(double);
+
+	lock.lock();
+	fwrite(&rec, sizeof(rec), 1, fp);
+	fwrite(input, len, 1, fp);
+	if ((rec.flags & VOSS_TRACE_SAME) == 0)
+		fwrite(output, len, 1, fp);
+	if (rec.extra != 0)
+		fwrite(fir->filter_data, rec.extra, 1, fp);
+	lock.unlock();
+
+	errno = error;
+	return (ret);
+}
+
+VOSSTraceReplay :: VOSSTraceReplay(int _fast)
+{
+	fast = _fast;
+	next_handle = VOSS_SIM_FD_BASE;
+}
+
+/* Load a trace for replay, NULL if it cannot be read */
+VOSSTraceReplay *
+VOSSTraceReplay :: create(const char *path, int fast)
+{
+	VOSSTraceReplay *tr;
+	FILE *fp;
+
+	fp = fopen(path, "r");
+	if (fp == NULL)
+		return (0);
+
+	tr = new VOSSTraceReplay(fast);
+	if (tr->load(fp) != 0) {
+		warnx("Invalid or truncated trace file: %s", path);
+		delete tr;
+		tr = 0;
+	}
+	fclose(fp);
+	return (tr);
+}
+
+int
+VOSSTraceReplay :: load(FILE *fp)
+{
+	VOSSTraceHeader hdr;
+	VOSSTraceEntry e;
+	QByteArray input;
+	QByteArray key;
+	VOSSTraceQueue *q;
+
+	if (fread(&hdr, sizeof(hdr), 1, fp) != 1 ||
+	    strncmp(hdr.magic, VOSS_TRACE_MAGIC, sizeof(hdr.magic)) != 0 ||
+	    hdr.version != VOSS_TRACE_VERSION ||
+	    hdr.record_size != sizeof(VOSSTraceRecord))
+		return (-1);
+
+	while (fread(&e.rec, sizeof(e.rec), 1, fp) == 1) {
+		if (e.rec.len > IOCPARM_MAX ||
+		    e.rec.extra > VIRTUAL_OSS_FILTER_MAX * sizeof(double))
+			return (-1);
+
+		input.resize(e.rec.len);
+		if (e.rec.len != 0 && fread(input.data(), e.rec.len, 1, fp) != 1)
+			return (-1);
+		if (e.rec.flags & VOSS_TRACE_SAME) {
+			e.output = input;
+		} else {
+			e.output.resize(e.rec.len);
+			if (fread(e.output.data(), e.rec.len, 1, fp) != 1)
+				return (-1);
+		}
+		e.extra.resize(e.rec.extra);
+		if (e.rec.extra != 0 && fread(e.extra.data(), e.rec.extra, 1, fp) != 1)
+			return (-1);
+
+		key = QByteArray((const char *)&e.rec.cmd, sizeof(e.rec.cmd)) + input;
+
+		q = &by_input[key];
+		if (q->entries.isEmpty())
+			q->next = 0;
+		q->entries.append(entries.size());
+
+		q = &by_cmd[e.rec.cmd];
+		if (q->entries.isEmpty())
+			q->next = 0;
+		q->entries.append(entries.size());
+
+		entries.append(e);
+	}
+	return (ferror(fp) ? -1 : 0);
+}
+
+int
+VOSSTraceReplay :: open(const char *path)
+{
+	QMutexLocker locker(&lock);
+
+	return (next_handle++);
+}
+
+void
+VOSSTraceReplay :: close(int fd)
+{
+
+}
+
+/* Take the next answer of a queue, the last one is repeated */
+const VOSSTraceEntry *
+VOSSTraceReplay :: next(VOSSTraceQueue *q)
+{
+	const VOSSTraceEntry *e = &entries[q->entries[q->next]];
+
+	if (q->next + 1 < q->entries.size())
+		q->next++;
+	return (e);
+}
+
+int
+VOSSTraceReplay :: ioctl(int fd, unsigned long cmd, void *arg)
+{
+	const size_t len = voss_trace_len(cmd, arg);
+	const quint64 code = cmd;
+	const VOSSTraceEntry *e;
+	struct virtual_oss_fir_filter *fir;
+	double *filter_data = 0;
+	int filter_size = 0;
+	char input[IOCPARM_MAX];
+	QHash<QByteArray, VOSSTraceQueue>::iterator qi;
+	QHash<quint64, VOSSTraceQueue>::iterator qc;
+
+	voss_trace_copy(cmd, input, arg, len);
+
+	lock.lock();
+	qi = by_input.find(QByteArray((const char *)&code, sizeof(code)) +
+	    QByteArray::fromRawData(input, len));
+	if (qi != by_input.end()) {
+		e = next(&qi.value());
+	} else if ((qc = by_cmd.find(code)) != by_cmd.end()) {
+		e = next(&qc.value());
+	} else {
+		lock.unlock();
+		errno = ENOTTY;
+		return (-1);
+	}
+	lock.unlock();
+
+	/* entries are never modified after loading */
+	if (fast == 0 && e->rec.dur_usec != 0)
+		usleep(e->rec.dur_usec);
+
+	if (e->rec.result != 0) {
+		errno = e->rec.error;
+		return (e->rec.result);
+	}
+
+	if (len != 0 && (size_t)e->output.size() == len) {
+		const int fir_kind = voss_io_fir(cmd);
+
+		if (fir_kind != VOSS_IO_FIR_NONE) {
+			fir = (struct virtual_oss_fir_filter *)arg;
+			filter_data = fir->filter_data;
+			filter_size = fir->filter_size;
+		}
+		memcpy(arg, e->output.constData(), len);
+		if (fir_kind != VOSS_IO_FIR_NONE) {
+			fir->filter_data = filter_data;
+
+			/* the taps only fit if the caller asked for as many */
+			if (filter_data != 0 && filter_size > 0 &&
+			    (size_t)e->extra.size() == filter_size * sizeof(double))
+				memcpy(filter_data, e->extra.constData(), e->extra.size());
+		}
+	}
+	return (0);
+}
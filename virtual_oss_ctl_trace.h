@@ -0,0 +1,130 @@
+/*-
+ * Copyright (c) 2026 Hans Petter Selasky. All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#ifndef _VOSS_CTL_TRACE_H_
+#define	_VOSS_CTL_TRACE_H_
+
+#include "virtual_oss_ctl_backend.h"
+
+#define	VOSS_REPLAY_PREFIX "replay:"
+#define	VOSS_REPLAY_FAST_PREFIX "replay-fast:"
+
+#define	VOSS_TRACE_MAGIC "VOSSTRC"
+#define	VOSS_TRACE_VERSION 1
+
+/*
+ * Trace file layout, in host byte order: one VOSSTraceHeader, then
+ * one VOSSTraceRecord per request followed by "len" bytes of input,
+ * "len" bytes of output unless VOSS_TRACE_SAME is set, and "extra"
+ * bytes of FIR filter taps read back by the request. The pointer in
+ * FIR requests is not recorded, only whether it was set.
+ */
+struct VOSSTraceHeader {
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+};
+
+#define	VOSS_TRACE_SAME 0x0001	/* output is equal to the input */
+
+struct VOSSTraceRecord {
+	uint64_t usec;		/* since the trace was started */
+	uint64_t cmd;
+	uint32_t dur_usec;
+	int32_t result;
+	int32_t error;
+	uint16_t len;
+	uint16_t flags;
+	uint32_t extra;
+	uint32_t reserved;
+};
+
+/* Record all requests passing to another backend */
+class VOSSTraceRecorder : public VOSSBackend
+{
+public:
+	VOSSTraceRecorder(VOSSBackend *, FILE *);
+	~VOSSTraceRecorder();
+
+	static VOSSTraceRecorder *create(VOSSBackend *, const char *);
+
+	int open(const char *);
+	void close(int);
+	int ioctl(int, unsigned long, void *);
+	void flush(void);
+
+private:
+	VOSSBackend *inner;
+	FILE *fp;
+	QMutex lock;
+	uint64_t start_usec;
+};
+
+struct VOSSTraceEntry {
+	VOSSTraceRecord rec;
+	QByteArray output;
+	QByteArray extra;
+};
+
+struct VOSSTraceQueue {
+	QVector<int> entries;
+	int next;
+};
+
+/*
+ * Play a trace back as the control device. Requests are matched to
+ * recorded ones by request code and input, in recorded order, since
+ * the threads of a new build do not issue them in the same order.
+ * When a queue runs out, its last answer is repeated. Requests with
+ * an input which was never recorded get the answers of their request
+ * code. Unless "fast" is set, each answer takes as long as it did
+ * when it was recorded. Only the duration of each request is replayed:
+ * the gaps between requests come from the timers of the new build,
+ * because its requests do not arrive in the recorded order anyway.
+ */
+class VOSSTraceReplay : public VOSSBackend
+{
+public:
+	VOSSTraceReplay(int);
+
+	static VOSSTraceReplay *create(const char *, int);
+
+	int open(const char *);
+	void close(int);
+	int ioctl(int, unsigned long, void *);
+
+private:
+	int load(FILE *);
+	const VOSSTraceEntry *next(VOSSTraceQueue *);
+
+	int fast;
+	QMutex lock;
+	QVector<VOSSTraceEntry> entries;
+	QHash<QByteArray, VOSSTraceQueue> by_input;
+	QHash<quint64, VOSSTraceQueue> by_cmd;
+	int next_handle;
+};
+
+#endif		/* _VOSS_CTL_TRACE_H_ */